@@ -35,22 +35,86 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <time.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-#define MAXLINE 81               /* Input buffer size */
+#define MAXLINE 4096             /* Input buffer size: command lines and file names */
 #define MAXNAME 31               /* File name size */
 
+#ifdef __AVX2__
+#define PWORDS 4                 /* words per node: 256 patterns fill an AVX2 lane */
+#else
+#define PWORDS 1                 /* words per node: 64 patterns per machine word */
+#endif
+#define PBITS (64 * PWORDS)      /* patterns simulated per bit-parallel pass */
+#define MTCHUNK 64               /* faults per work-stealing task */
+#define MTMAX 256                /* most threads of MTFS and MTSIM */
+#define MTSBATCH 256             /* pattern blocks MTSIM holds at a time */
+#define CACHEMAGIC "FSIMNET"     /* first 8 bytes of a compiled netlist */
+#define CACHEVERSION 2           /* bump when the cache layout changes */
+#define PATMAGIC "FSIMPAT"       /* first 8 bytes of a packed binary pattern file */
+#define CSIMVERSION 1            /* bump when the generated code changes */
+#define CSIMCHUNK 1024           /* nodes per generated C function */
+#define BTLIMIT 100              /* default PODEM backtrack limit */
+#define SCOAPMAX (1 << 24)       /* SCOAP measures saturate here */
+#define LX 2                     /* the X of the PODEM 0/1/X values */
+#define FLIPPED (1 << 30)        /* PODEM decision already tried both ways */
+#define SATLIMIT 10000           /* default SAT conflict limit per fault */
+#define SATRESTART 100           /* conflicts per unit of the Luby restarts */
+#define SATSLACK 100000          /* solver growth allowed before a rebuild */
+#define COMPACTTRY 32            /* faults tried per test by dynamic compaction */
+#define COMPACTBT 10             /*   and their PODEM backtrack limit */
+#define RPGNEW 8                 /* random phase stops below RPGNEW new detections */
+#define RPGWINDOW 16             /*   in the last RPGWINDOW blocks of 64 patterns */
+#define GENWORDS 8               /* random words per signal of the GEN gate checks */
+#define GENTRY 8                 /*   and the draws for a gate that passes them */
+#define GENSAMPLE 2000           /* faults GEN simulates to estimate the redundancy */
+#define GENPASS 16               /*   over GENPASS passes of GENWORDS random words */
+#define XSEED 88172645463325252ULL  /* xorshift64 seed, reset by ATPG and COMPACT */
+#define BENCHPHASES 13           /* phases timed by BENCH */
+#define BTBUCKETS 16             /* STATS histogram of backtracks: 0, 1, 2-3, 4-7, ... */
+
 #define Upcase(x) ((isalpha(x) && islower(x))? toupper(x) : (x))
 #define Lowcase(x) ((isalpha(x) && isupper(x))? tolower(x) : (x))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* Trace output of the simulation kernels. It is compiled in with
+   -DFSIMTRACE only and then printed at VERBOSE 3, for every node/fault or
+   for the one selected by the VERBOSE command. */
+#ifdef FSIMTRACE
+#define TRACE(p, fid, ...) \
+  do { if (Verbose >= 3 && trace_on(p, fid)) fprintf(stderr, __VA_ARGS__); } while (0)
+#else
+#define TRACE(p, fid, ...) do { } while (0)
+#endif
 
 enum e_com {READ, PC, HELP, QUIT, LEV};
-enum e_state {EXEC, CKTLD};         /* Gstate values */
+enum e_state {EXEC, CKTLD, CKTLEV}; /* Gstate values */
 enum e_ntype {GATE, PI, FB, PO};    /* column 1 of circuit format */
 enum e_gtype {IPT, BRCH, XOR, OR, NOR, NOT, NAND, AND};  /* gate types */
+enum e_fstat {FS_UNDET, FS_DET, FS_RED, FS_ABORT};       /* ATPG fault status */
+enum e_phase {PH_PARSE, PH_LEV, PH_COLLAPSE, PH_SIM, PH_ATPG, PH_NONE};  /* STATS timers */
 
 struct cmdstruc {
    char name[MAXNAME];        /* command syntax */
    int (*fptr)();             /* function pointer of the commands */
    enum e_state state;        /* execution state sequence */
+   enum e_phase phase;        /* STATS timer charged with the command */
 };
 
 typedef struct n_struc {
@@ -63,8 +127,6 @@ typedef struct n_struc {
    struct n_struc **dnodes;   /* pointer to array of down nodes */
    int level;                 /* level of the gate output */
    bool islevel;
-   int node_value;            /* value of node:0,1,2(fault free),3(either SA1 or SA0) */
-   int *L;                    /* fault list of each node */
 } NSTRUC;                     
 
 typedef struct fl_struc {
@@ -73,48 +135,375 @@ typedef struct fl_struc {
    bool s_a_1;                /* Stuck-at-1 fault*/
 } FAULTLIST;
 
+typedef struct a_block {
+   struct a_block *next;      /* next block of the arena */
+   size_t size;               /* bytes in data[] */
+   size_t used;               /* bytes handed out */
+   char data[];
+} ABLOCK;
+
+typedef struct a_struc {
+   ABLOCK *first;             /* first block, kept across resets */
+   ABLOCK *cur;               /* block currently allocated from */
+   size_t bsize;              /* default block size */
+   size_t inuse;              /* bytes handed out since the last reset */
+   size_t peak;               /* largest inuse seen */
+} ARENA;
+
+typedef struct cf_struc {
+   int *f;                    /* sorted ids of the faulty machines that differ */
+   int n;                     /* number of entries in f */
+   int cap;                   /* allocated entries of f */
+} CFLIST;
+
+typedef struct pp_struc {
+   uint64_t *fval;            /* faulty values of the fault being propagated */
+   int *stamp;                /* fval[i] is valid when stamp[i] == mark */
+   int *qstamp;               /* node i is queued when qstamp[i] == mark */
+   int mark;                  /* current fault number */
+   int *queue;                /* level buckets laid out like Lorder */
+   int *qn;                   /* entries in each level bucket */
+   uint64_t nevals;           /* gate evaluations, added to Stats by ppsfp_free */
+   uint64_t nevents;          /* nodes queued, likewise */
+} PPSTRUC;
+
+typedef struct st_struc {
+   double wall[PH_NONE];      /* wall clock seconds of each phase */
+   double cpu[PH_NONE];       /* CPU seconds of each phase, all threads */
+   int calls[PH_NONE];        /* commands run in each phase */
+   uint64_t evals;            /* gate evaluations: a node on one value word */
+   uint64_t events;           /* nodes scheduled by the event-driven engines */
+   uint64_t blocks;           /* pattern blocks of the fault dropping engines */
+   uint64_t dropped;          /* faults they dropped */
+   uint64_t maxdrop;          /* most faults dropped by one block */
+   uint64_t targets;          /* PODEM calls on ATPG target faults */
+   uint64_t backtracks;       /* their backtracks */
+   uint64_t maxbt;            /* most backtracks of one target */
+   uint64_t bthist[BTBUCKETS];  /* targets by backtracks, log2 buckets */
+   uint64_t abytes;           /* bytes handed out by the arenas */
+   uint64_t ablocks;          /* bytes of arena blocks malloc'ed */
+   uint64_t *flsum;           /* deductive fault list entries built per level */
+   uint64_t *flcnt;           /* fault lists built per level */
+   uint64_t *flmax;           /* largest fault list per level */
+   int nlev;                  /* levels of flsum, flcnt and flmax */
+} STATS;
+
+typedef struct ws_struc {
+   int *task;                 /* first live-list index of each chunk */
+   int top;                   /* next chunk for a thief */
+   int bottom;                /* one past the next chunk for the owner */
+   pthread_mutex_t lock;
+} WSDEQUE;
+
+typedef struct mt_struc {
+   int id;                    /* worker number, 0 is the calling thread */
+   PPSTRUC w;                 /* private propagation buffers */
+   WSDEQUE dq;                /* chunks assigned to this worker */
+} MTWORKER;
+
+typedef struct mts_struc {
+   uint64_t *piw;             /* packed primary input words, block after block */
+   uint64_t *pow;             /* primary output words, same layout */
+   int nblock;                /* PBITS pattern blocks of the batch */
+   int next;                  /* next block to claim */
+} MTSJOB;
+
+typedef struct ch_struc {
+   char magic[8];             /* CACHEMAGIC */
+   uint32_t version;          /* CACHEVERSION */
+   uint32_t nnodes;           /* number of nodes */
+   uint32_t npi;              /* number of primary inputs */
+   uint32_t npo;              /* number of primary outputs */
+   uint32_t maxlevel;         /* maximum level */
+   uint32_t nfan;             /* number of fanin (= fanout) edges */
+   uint64_t srcsize;          /* size of the circuit file */
+   uint64_t srchash;          /* text_hash of the circuit file */
+} CACHEHDR;
+
+typedef struct pf_struc {
+   char magic[8];             /* PATMAGIC */
+   uint32_t width;            /* bits per pattern: Npi, or Npo for responses */
+   uint32_t pad;
+   uint64_t npat;             /* number of patterns */
+} PATHDR;                     /* followed by blocks of 64 patterns, width words each */
+
+typedef struct ps_struc {
+   FILE *fd;                  /* pattern file */
+   int binary;                /* packed binary file (PATHDR) instead of text */
+   uint64_t left;             /* patterns still to read from a binary file */
+   char *pat;                 /* line buffer of a text file */
+   uint64_t *buf[2];          /* double buffer, Npi * PWORDS words: PI i at i * PWORDS */
+   int n[2];                  /* patterns in each buffer, -1 while it is free */
+   int next;                  /* buffer the simulator takes next */
+   int stop;                  /* set to stop the reader early */
+   int sync;                  /* no reader thread: pat_next fills the buffers */
+   pthread_t tid;
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+} PATSTREAM;
+
+typedef struct watch_struc {
+   int *w;                    /* clauses watching the literal */
+   int n, cap;
+} WATCH;
+
+typedef struct sat_struc {
+   int nvars, cap;            /* variables and allocated variables */
+   WATCH *watch;              /* watch list of each literal 2 * var + sign */
+   int *cdb;                  /* clauses: size followed by the literals */
+   int ncdb, cdbcap;          /* words used and allocated in cdb */
+   int base;                  /* words of the good circuit clauses */
+   uint8_t *val;              /* value of each variable: 0, 1 or LX */
+   int *level;                /* decision level of each assignment */
+   int *reason;               /* implying clause, -1 for decisions */
+   double *act, inc;          /* VSIDS activity and its increment */
+   uint8_t *phase;            /* saved phase of each variable */
+   char *seen;                /* conflict analysis marks */
+   int *trail, ntrail, qhead; /* assignment order, propagation head */
+   int *lim, nlevel;          /* trail size at the start of each level */
+   int *heap, nheap, *hpos;   /* decision heap of the variables */
+   int *learnt;               /* learnt clause buffer */
+   int ok;                    /* 0 once the clauses are unsatisfiable */
+   long nconflicts;           /* conflicts over all calls */
+} SATSOLVER;
+
 /*----------------- Command definitions ----------------------------------*/
-#define NUMFUNCS 9
+#define NUMFUNCS 24
 int cread(), pc(), help(), quit(), lev(), preprocessor(), pfs(),fault_free_simulation();
+int psim();
+int sim_patterns(char *cp, void (*sim)(uint64_t *, int), char *name);
+int pat_open(PATSTREAM *ps, char *name);
+void *pat_reader(void *arg);
+int pat_fill(PATSTREAM *ps, uint64_t *buf);
+int pat_next(PATSTREAM *ps, uint64_t **words);
+void pat_done(PATSTREAM *ps);
+void pat_close(PATSTREAM *ps);
+FILE *resp_open(char *name, int width, int *binary);
+void resp_write(FILE *fo, int binary, uint32_t *pos, int width, uint64_t *val, int nw, int p);
+void resp_close(FILE *fo, int binary, uint64_t npat);
+int pack();
+int gen();
+int gen_related(int npi, int *fin, int *nfin, int a, int b);
+uint64_t gen_op(int type, uint64_t *u, int n);
+int gen_weak(int type, int *in, int n, uint64_t *val, uint64_t *out);
+int gen_estimate(int npi, int ngates, int *type, int *fin, int *nfin, int *nout,
+                 uint64_t *val, int *nsample);
+int bench();
+int bench_patterns(char *name, int npat);
+double wall_clock();
+double cpu_clock();
+int stats();
+void stats_drop(int n);
+long peak_rss();
+int batch(int argc, char **argv);
+int verbose();
+int trace_on(int p, int fid);
+int csim();
+uint64_t netlist_hash();
+int csim_load();
+int csim_emit(char *name);
+int atpg();
+void atpg_init();
+void scoap();
+int testability();
+int fault_cost(int fid);
+int fault_cmp(const void *a, const void *b);
+int eval3(int p, uint8_t *a);
+void podem_imply(int p);
+void podem_assign(int p, int v);
+int podem_backtrace(int p, int *v);
+int podem(int fid, int limit);
+int podem_xpath(int n);
+void podem_undo(int base);
+void podem_release();
+void podem_reset();
+int dynamic_compact(int fid, int *live, int nlive);
+void tset_add(char *pat, char *cube);
+int tset_sim(PPSTRUC *w, uint64_t *good, char *set, int n, int reverse,
+             int *live, int *nlive, char *need);
+int compact();
+int random_phase(PPSTRUC *w, uint64_t *good, int *live, int *nlive, int rn, int rk,
+                 FILE *fo, char *pat, int *nblock);
+uint64_t xrand();
+void sat_free();
+int sat_newvars(int n);
+void heap_insert(int v);
+int heap_pop();
+void sat_enqueue(int lit, int reason);
+void sat_watch(int lit, int cr);
+int sat_addclause(int *lits, int n);
+int sat_store(int *lits, int n);
+int sat_propagate();
+void sat_bump(int v);
+int sat_analyze(int cr, int *blevel);
+void sat_backtrack(int level);
+int luby(int i);
+int sat_solve(int *assume, int na, int limit);
+void sat_gate(int type, int o, int *in, int n, int g);
+void sat_init();
+int sat_atpg(int fid, int limit, char *pat);
+int read_pattern(FILE *fd, char *pat);
+void pack_pattern(char *pat, int p, uint64_t *val, int nw);
+void eval_word(int p, uint64_t *val, int nw);
+void parallel_sim(uint64_t *val, int nw);
+int build_target_faults();
+int uf_find(int *uf, int x);
+void uf_union(int *uf, int x, int y);
 int  deductive_fault_simulation();
-int* union_op(int *x, int *y);
-int* intersaction_op(int *x, int *y);
-int* minus_op(int *x, int *y);
-int fault_list_propogate(NSTRUC* np);
+void logic_sim(char *pat);
+void *arena_alloc(ARENA *a, size_t n);
+void *arena_zalloc(ARENA *a, size_t n);
+size_t arena_size(ARENA *a);
+void arena_reset(ARENA *a);
+void arena_free(ARENA *a);
+int union_op(int *x, int nx, int *y, int ny, int *z);
+int intersaction_op(int *x, int nx, int *y, int ny, int *z);
+int minus_op(int *x, int nx, int *y, int ny, int *z);
+int xor_op(int *x, int nx, int *y, int ny, int *z);
+int fault_list_propogate(int p);
+int bitset_dfs();
+void bits_or(uint64_t *z, uint64_t *x, uint64_t *y, int n);
+void bits_and(uint64_t *z, uint64_t *x, uint64_t *y, int n);
+void bits_andn(uint64_t *z, uint64_t *x, uint64_t *y, int n);
+void bits_xor(uint64_t *z, uint64_t *x, uint64_t *y, int n);
+void bitset_propogate(int p, uint64_t *fl, int nw);
+int gate_eval(int p, int *in);
+int concurrent_fault_simulation();
+int cfs_evaluate(int p, int *gv, CFLIST *cl, char *drop, int *scratch);
+int ppsfp();
+void ppsfp_init(PPSTRUC *w);
+void ppsfp_free(PPSTRUC *w);
+uint64_t ppsfp_fault(PPSTRUC *w, int fid, uint64_t *good, uint64_t valid, int full);
+uint64_t eval_fault_word(int p, PPSTRUC *w, uint64_t *good);
+int drop_detected(int *live, int nlive, int *detp, int base, int p, FILE *fo);
+int mt_fault_simulation();
+int deque_pop(WSDEQUE *dq);
+int deque_steal(WSDEQUE *dq);
+void mt_run(MTWORKER *me);
+void *mt_worker(void *arg);
+int mt_simulation();
+void *mtsim_worker(void *arg);
+uint64_t text_hash(char *p, size_t n);
+void build_nodes(int n, int *num, int *gtype, int *foff, int *fan,
+                 int *doff, int *dfan, int *pil, int *pol);
+int load_cache(char *name, uint64_t hash, uint64_t size);
+int csr_ok(int *off, int *idx, int n, int nidx, int bound);
+void write_cache();
+void build_csr();
 struct cmdstruc command[NUMFUNCS] = {
-   {"READ", cread, EXEC},
-   {"PC", pc, CKTLD},
-   {"HELP", help, EXEC},
-   {"QUIT", quit, EXEC},
-   {"LEV", lev, CKTLD},
-   {"GFL", preprocessor, CKTLD},
-   {"PFS", pfs, CKTLD},
-   {"DFS", deductive_fault_simulation, CKTLD},
-   {"FFS", fault_free_simulation, CKTLD},
+   {"READ", cread, EXEC, PH_PARSE},
+   {"PC", pc, CKTLD, PH_NONE},
+   {"HELP", help, EXEC, PH_NONE},
+   {"QUIT", quit, EXEC, PH_NONE},
+   {"LEV", lev, CKTLD, PH_LEV},
+   {"GFL", preprocessor, CKTLD, PH_COLLAPSE},
+   {"PFS", pfs, CKTLEV, PH_SIM},
+   {"DFS", deductive_fault_simulation, CKTLEV, PH_SIM},
+   {"BDFS", bitset_dfs, CKTLEV, PH_SIM},
+   {"CFS", concurrent_fault_simulation, CKTLEV, PH_SIM},
+   {"PPSFP", ppsfp, CKTLEV, PH_SIM},
+   {"MTFS", mt_fault_simulation, CKTLEV, PH_SIM},
+   {"MTSIM", mt_simulation, CKTLEV, PH_SIM},
+   {"FFS", fault_free_simulation, CKTLEV, PH_SIM},
+   {"PSIM", psim, CKTLEV, PH_SIM},
+   {"CSIM", csim, CKTLEV, PH_SIM},
+   {"ATPG", atpg, CKTLEV, PH_ATPG},
+   {"SCOAP", testability, CKTLEV, PH_NONE},
+   {"COMPACT", compact, CKTLEV, PH_ATPG},
+   {"PACK", pack, CKTLD, PH_NONE},
+   {"VERBOSE", verbose, EXEC, PH_NONE},
+   {"GEN", gen, EXEC, PH_NONE},
+   {"BENCH", bench, EXEC, PH_NONE},
+   {"STATS", stats, EXEC, PH_NONE},
 };
 
 /*------------------------------------------------------------------------*/
 enum e_state Gstate = EXEC;     /* global exectution sequence */
 NSTRUC *Node;                   /* dynamic array of nodes */
+NSTRUC **Upool, **Dpool;        /* unodes/dnodes of all nodes, node after node */
+char Cachename[MAXLINE + 4];    /* compiled netlist of the current circuit */
+uint64_t Cachehash, Cachesize;  /* hash and size of the current circuit file */
+int Cachepending;               /* write the compiled netlist after LEV */
 NSTRUC **Pinput;                /* pointer to array of primary inputs */
 NSTRUC **Poutput;               /* pointer to array of primary outputs */
 int Nnodes;                     /* number of nodes */
 int Npi;                        /* number of primary inputs */
 int Npo;                        /* number of primary outputs */
 int Done = 0;                   /* status bit to terminate program */
-int Maxlevel; 
-int count = 0;                  /* maximum value of levelization */
+int Maxlevel;                   /* maximum value of levelization */
+int count = 0;
+int *Lorder;                    /* node indices sorted by level: evaluation schedule */
+int *Loffset;                   /* Lorder[Loffset[l]..Loffset[l+1]-1] are at level l */
+/* Structure-of-arrays netlist for the simulators. Nodes are renumbered in
+   level order: position p holds Node[Lorder[p]], Cpos maps back. */
+int *Cpos;                      /* position of each node index */
+uint8_t *Ctype;                 /* gate type of each position */
+int *Clevel;                    /* level of each position */
+uint32_t *Cfin, *Cfan;          /* fanins of p: Cfan[Cfin[p]..Cfin[p+1]-1] */
+uint32_t *Cfout, *Cdfan;        /* fanouts of p: Cdfan[Cfout[p]..Cfout[p+1]-1] */
+uint32_t *Cpi, *Cpo;            /* positions of the primary inputs/outputs */
+uint8_t *Cval;                  /* fault free value of each position */
 FAULTLIST *CompleteFL;          /* complete single stuck-at-fault fault list */
 FAULTLIST *CollapsedFL;         /* collapsed fault list */
+int Ncollapsed;                 /* number of entries in CollapsedFL */
+int *Flist;                     /* target faults, fault id = 2 * indx + stuck value */
+int Nflist;                     /* number of target faults */
+uint64_t *Pval;                 /* bit-parallel node values, PWORDS words per node */
+uint64_t *Fmask0, *Fmask1;      /* per-node stuck-at-0/1 injection masks of PFS */
+char *Pomark;                   /* Pomark[p] is 1 for primary output positions */
+MTWORKER *Mtw;                  /* workers of MTFS */
+int Mtn;                        /* number of MTFS workers */
+pthread_barrier_t Mtbar;        /* start/end of a pattern block */
+pthread_mutex_t Mtstart = PTHREAD_MUTEX_INITIALIZER;  /* held until Mtbar is set */
+int Mtdone;                     /* set to stop the MTFS workers */
+uint64_t *Mtgood;               /* shared good machine values of the block */
+uint64_t Mtvalid;               /* valid pattern bits of the block */
+int *Mtlive, Mtnlive;           /* shared live fault list */
+int *Mtdetp;                    /* detecting pattern of each live fault */
+ARENA Netarena = {NULL, NULL, 1 << 20}; /* circuit and its derived arrays, until the next READ */
+ARENA Runarena = {NULL, NULL, 1 << 20}; /* scratch of one command, reset before the next */
+ARENA Patarena = {NULL, NULL, 1 << 20}; /* per-pattern storage of the fault lists */
+int **Dfl;                      /* deductive fault list of each position: sorted */
+int *Dfn;                       /* fault ids 2 * indx + stuck value, and its size */
+int *Ltmp[2];                   /* scratch lists of fault_list_propogate */
+int Ltmpsize;                   /* capacity of each scratch list */
+void *Csimlib;                  /* dlopen handle of the compiled simulator */
+void (*Csimfn)(uint64_t *, int);  /* its entry point, same contract as parallel_sim */
+int *Cc0, *Cc1, *Co;            /* SCOAP controllability/observability by position */
+int Forder;                     /* Flist order: 1 hardest first, -1 easiest, 0 as listed */
+uint8_t *Ag, *Af;               /* PODEM good/faulty values: 0, 1 or LX */
+char *Ainq;                     /* node is in the implication queue */
+int *Aqueue, *Aqn;              /* implication queue: level buckets like Lorder */
+int *Acone, *Astamp, Amark;     /* fanout cone of the target fault */
+int Abase;                      /* decisions below Abase are fixed (dynamic compaction) */
+int *Axq, *Axstamp, Axmark;     /* X-path search from the D-frontier */
+int *Astack, Ansp;              /* PODEM decisions: 2 * position + value */
+int Anbt;                       /* backtracks of the last PODEM call */
+int Asite, Asa;                 /* position and stuck value of the target fault */
+char *Fstat;                    /* e_fstat of each fault id after ATPG */
+char *Tset;                     /* test set, Npi characters per test */
+char *Tcube;                    /* the same tests with X on inputs ATPG left free */
+int Ntset, Tcap;                /* tests in Tset and its capacity */
+uint64_t Xstate = XSEED;        /* xorshift64 state */
+SATSOLVER Sat;                  /* SAT solver of the ATPG, good circuit built in */
+int *Sfv;                       /* faulty and D literals of the cone positions */
+int Verbose = 1;                /* 0 quiet, 1 summaries, 2 listings, 3 traces */
+int Tnode = -1, Tfault = -1;    /* node index and fault id traced, -1: all */
+STATS Stats;                    /* phase timers and counters of the STATS command */
 /*------------------------------------------------------------------------*/
 
 /*-----------------------------------------------------------------------
-input: nothing
-output: nothing
+input: optional batch arguments: circuit patfile respfile [detfile]
+output: exit status
 called by: shell
 description:
-  This is the main program of the simulator. It displays the prompt, reads
-  and parses the user command, and calls the corresponding routines.
+  This is the main program of the simulator. With arguments it runs one
+  batch simulation (see batch) and exits. Otherwise it displays the
+  prompt, reads and parses the user command, and calls the
+  corresponding routines, charging their wall and CPU time to the
+  command's STATS phase. The scratch memory of the previous command
+  (Runarena) is reset first. A line longer than the MAXLINE buffer is
+  rejected whole rather than split into two commands.
   Commands not reconized by the parser are passed along to the shell.
   The command is executed according to some pre-determined sequence.
   For example, we have to read in the circuit description file before any
@@ -123,17 +512,27 @@ description:
   Pointers to functions are used to make function calls which makes the
   code short and clean.
 -----------------------------------------------------------------------*/
-main()
+main(argc, argv)
+int argc;
+char **argv;
 {
    enum e_com com;
+   enum e_phase ph;
    char cline[MAXLINE], wstr[MAXLINE], *cp;
-   cread("c17.ckt");
-   lev();
-   fault_free_simulation();
+   double t, c;
+   int ch;
 
+   if(argc > 1) return batch(argc - 1, argv + 1);
+   setvbuf(stdout, NULL, _IOFBF, 1 << 16);
    while(!Done) {
       printf("\nCommand>");
-      fgets(cline, MAXLINE, stdin);
+      fflush(stdout);
+      if(fgets(cline, MAXLINE, stdin) == NULL) break;
+      if(strchr(cline, '\n') == NULL && !feof(stdin)) {
+         printf("Command line longer than %d characters!\n", MAXLINE - 2);
+         while((ch = getchar()) != EOF && ch != '\n');
+         continue;
+      }
       if(sscanf(cline, "%s", wstr) != 1) continue;
       cp = wstr;
       while(*cp){
@@ -144,104 +543,448 @@ main()
       com = READ;
       while(com < NUMFUNCS && strcmp(wstr, command[com].name)) com++;
       if(com < NUMFUNCS) {
-         if(command[com].state <= Gstate) (*command[com].fptr)(cp);
-         else printf("Execution out of sequence!\n");
+         arena_reset(&Runarena);
+         if(command[com].state > Gstate) printf("Execution out of sequence!\n");
+         else if((ph = command[com].phase) == PH_NONE) (*command[com].fptr)(cp);
+         else {
+            t = wall_clock();
+            c = cpu_clock();
+            (*command[com].fptr)(cp);
+            Stats.wall[ph] += wall_clock() - t;
+            Stats.cpu[ph] += cpu_clock() - c;
+            Stats.calls[ph]++;
+         }
+      }
+      else {
+         fflush(stdout);
+         system(cline);
       }
-      else system(cline);
    }
+   fflush(stdout);
 }
 
 /*-----------------------------------------------------------------------
-input: circuit description file name
+input: scan position, end of buffer, result
+output: 1 if an integer was read, 0 at end of buffer
+called by: cread
+description:
+  Hand-rolled integer scanner for the circuit file: skips white space
+  and reads an optionally signed decimal integer.
+-----------------------------------------------------------------------*/
+int scan_int(char **pp, char *end, int *v)
+{
+   char *p = *pp;
+   int neg, n;
+
+   while(1) {
+      while(p < end && isspace((unsigned char) *p)) p++;
+      if(p == end) {
+         *pp = p;
+         return 0;
+      }
+      neg = (*p == '-');
+      if(neg) p++;
+      for(n = 0; p < end && isdigit((unsigned char) *p); p++) n = 10 * n + (*p - '0');
+      if(p == end || isspace((unsigned char) *p)) break;
+      while(p < end && !isspace((unsigned char) *p)) p++;    /* not a number: skip */
+   }
+   *pp = p;
+   *v = neg ? -n : n;
+   return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: text, length
+output: 64-bit hash
+called by: cread
+description:
+  FNV-1a style hash of the circuit file, taken 8 bytes at a time. It
+  tells whether a compiled-netlist cache still matches its source.
+-----------------------------------------------------------------------*/
+uint64_t text_hash(char *p, size_t n)
+{
+   uint64_t h = 1469598103934665603ULL, w;
+   size_t i;
+
+   for(i = 0; i + 8 <= n; i += 8) {
+      memcpy(&w, p + i, 8);
+      h = (h ^ w) * 1099511628211ULL;
+      h ^= h >> 32;
+   }
+   for(; i < n; i++) h = (h ^ (unsigned char) p[i]) * 1099511628211ULL;
+   return h ^ n;
+}
+
+/*-----------------------------------------------------------------------
+input: number of nodes, line numbers, gate types, fanin offsets and
+       fanin node indices, fanout offsets and fanout node indices (NULL
+       to derive them from the fanins), PI and PO node indices
+output: nothing
+called by: cread, load_cache
+description:
+  Set up Node, Pinput and Poutput from a netlist in compressed rows
+  (CSR): the fanins of node i are fan[foff[i]..foff[i+1]-1]. unodes and
+  dnodes of all nodes are slices of the pools Upool and Dpool, which
+  are allocated from Netarena with Node. Missing fanouts are counted
+  from the fanins and turned into offsets by a prefix sum.
+-----------------------------------------------------------------------*/
+void build_nodes(int n, int *num, int *gtype, int *foff, int *fan,
+                 int *doff, int *dfan, int *pil, int *pol)
+{
+   int i, j, *cnt = NULL;
+   NSTRUC *np;
+
+   Nnodes = n;
+   allocate();
+   Upool = (NSTRUC **) arena_alloc(&Netarena, (foff[n] + 1) * sizeof(NSTRUC *));
+   Dpool = (NSTRUC **) arena_alloc(&Netarena, (foff[n] + 1) * sizeof(NSTRUC *));
+   if(doff == NULL) {
+      cnt = (int *) arena_zalloc(&Runarena, (n + 1) * sizeof(int));
+      for(i = 0; i < foff[n]; i++) cnt[fan[i] + 1]++;
+      for(i = 0; i < n; i++) cnt[i + 1] += cnt[i];
+      doff = cnt;
+   }
+   for(i = 0; i < n; i++) {
+      np = &Node[i];
+      np->num = num[i];
+      np->type = gtype[i];
+      np->fin = foff[i + 1] - foff[i];
+      np->unodes = Upool + foff[i];
+      for(j = 0; j < np->fin; j++) np->unodes[j] = &Node[fan[foff[i] + j]];
+      np->fout = doff[i + 1] - doff[i];
+      np->dnodes = Dpool + doff[i];
+   }
+   if(cnt != NULL) {
+      for(i = 0; i < n; i++)
+         for(j = foff[i]; j < foff[i + 1]; j++) Dpool[cnt[fan[j]]++] = &Node[i];
+   }
+   else
+      for(i = 0; i < doff[n]; i++) Dpool[i] = &Node[dfan[i]];
+   for(i = 0; i < Npi; i++) Pinput[i] = &Node[pil[i]];
+   for(i = 0; i < Npo; i++) Poutput[i] = &Node[pol[i]];
+}
+
+/*-----------------------------------------------------------------------
+input: cache file name, hash and size of the circuit file
+output: 1 if the circuit was loaded from the cache, 0 otherwise
+called by: cread
+description:
+  Load a compiled netlist written by write_cache. The file is mapped
+  with one mmap; it is used only if its magic, version, source size and
+  source hash match and its length agrees with the counts in the
+  header. A valid cache also restores the levels, the evaluation
+  schedule and the SCOAP measures, so the circuit is ready for
+  simulation and test generation without LEV. The maximum level must
+  be below the node count, and every offset, index, level and SCOAP
+  measure (0..SCOAPMAX) is range checked (csr_ok) before it is used, so
+  a damaged file is parsed again like a missing one and rewritten by
+  the next LEV.
+-----------------------------------------------------------------------*/
+int load_cache(char *name, uint64_t hash, uint64_t size)
+{
+   CACHEHDR *h;
+   struct stat st;
+   uint32_t *a;
+   int fd, i, n, ok;
+   int *num, *gtype, *level, *foff, *fan, *doff, *dfan, *pil, *pol, *lorder, *loff, *sc;
+
+   if((fd = open(name, O_RDONLY)) < 0) return 0;
+   if(fstat(fd, &st) != 0 || st.st_size < sizeof(CACHEHDR)) {
+      close(fd);
+      return 0;
+   }
+   h = (CACHEHDR *) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if(h == MAP_FAILED) return 0;
+   ok = !memcmp(h->magic, CACHEMAGIC, 8) && h->version == CACHEVERSION &&
+        h->srchash == hash && h->srcsize == size &&
+        st.st_size == sizeof(CACHEHDR) + sizeof(uint32_t) * ((uint64_t) 9 * h->nnodes +
+        2 * h->nfan + h->npi + h->npo + h->maxlevel + 4);
+   if(!ok) {
+      munmap(h, st.st_size);
+      return 0;
+   }
+
+   n = h->nnodes;
+   a = (uint32_t *) (h + 1);
+   num = (int *) a;    a += n;
+   gtype = (int *) a;  a += n;
+   level = (int *) a;  a += n;
+   foff = (int *) a;   a += n + 1;
+   fan = (int *) a;    a += h->nfan;
+   doff = (int *) a;   a += n + 1;
+   dfan = (int *) a;   a += h->nfan;
+   pil = (int *) a;    a += h->npi;
+   pol = (int *) a;    a += h->npo;
+   lorder = (int *) a;
+   loff = (int *) a + n;
+   sc = loff + h->maxlevel + 2;        /* Cc0, Cc1 and Co */
+   ok = n > 0 && h->maxlevel < h->nnodes && csr_ok(NULL, gtype, n, n, AND + 1) &&
+        csr_ok(NULL, level, n, n, h->maxlevel + 1) &&
+        csr_ok(foff, fan, n, h->nfan, n) && csr_ok(doff, dfan, n, h->nfan, n) &&
+        csr_ok(NULL, pil, h->npi, h->npi, n) && csr_ok(NULL, pol, h->npo, h->npo, n) &&
+        csr_ok(loff, lorder, h->maxlevel + 1, n, n) &&
+        csr_ok(NULL, sc, 3 * n, 3 * n, SCOAPMAX + 1);
+   if(!ok) {
+      munmap(h, st.st_size);
+      return 0;
+   }
+   Npi = h->npi;
+   Npo = h->npo;
+   build_nodes(n, num, gtype, foff, fan, doff, dfan, pil, pol);
+
+   Maxlevel = h->maxlevel;
+   for(i = 0; i < n; i++) {
+      Node[i].level = level[i];
+      Node[i].islevel = 1;
+   }
+   Lorder = (int *) arena_alloc(&Netarena, n * sizeof(int));
+   memcpy(Lorder, lorder, n * sizeof(int));
+   Loffset = (int *) arena_alloc(&Netarena, (n + 2) * sizeof(int));
+   memcpy(Loffset, loff, (Maxlevel + 2) * sizeof(int));
+   Cc0 = (int *) arena_alloc(&Netarena, n * sizeof(int));
+   Cc1 = (int *) arena_alloc(&Netarena, n * sizeof(int));
+   Co = (int *) arena_alloc(&Netarena, n * sizeof(int));
+   memcpy(Cc0, sc, n * sizeof(int));
+   memcpy(Cc1, sc + n, n * sizeof(int));
+   memcpy(Co, sc + 2 * n, n * sizeof(int));
+   munmap(h, st.st_size);
+   return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: offsets (NULL for a plain list), indices, number of rows, number
+       of indices, bound of the indices
+output: 1 if the offsets run from 0 to nidx without going back and every
+        index is in [0, bound), 0 otherwise
+called by: load_cache
+description:
+  Range check of an array read from a cache file, so that a damaged
+  or hand-edited file cannot send the simulator outside its arrays.
+  Plain value arrays (levels, SCOAP measures) are checked the same way.
+-----------------------------------------------------------------------*/
+int csr_ok(int *off, int *idx, int n, int nidx, int bound)
+{
+   int i;
+
+   if(off != NULL) {
+      if(off[0] != 0 || off[n] != nidx) return 0;
+      for(i = 0; i < n; i++)
+         if(off[i + 1] < off[i]) return 0;
+   }
+   for(i = 0; i < nidx; i++)
+      if(idx[i] < 0 || idx[i] >= bound) return 0;
+   return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
 output: nothing
+called by: lev
+description:
+  Write the levelized circuit to the cache file chosen by cread: line
+  numbers, gate types, levels, fanin and fanout CSR arrays, the PI and
+  PO index lists, the evaluation schedule and the SCOAP measures (by
+  position), behind a header with the size and hash of the source. The
+  file is written under a temporary name and renamed, so a reader never
+  sees a partial cache. Failing to write the cache (e.g. a read-only
+  directory) is not an error.
+-----------------------------------------------------------------------*/
+void write_cache()
+{
+   char tmp[MAXLINE + 8];
+   CACHEHDR h;
+   FILE *fd;
+   int i, j, *a;
+
+   Cachepending = 0;
+   sprintf(tmp, "%s.tmp", Cachename);
+   if((fd = fopen(tmp, "wb")) == NULL) return;
+   memset(&h, 0, sizeof(h));
+   memcpy(h.magic, CACHEMAGIC, 8);
+   h.version = CACHEVERSION;
+   h.nnodes = Nnodes;
+   h.npi = Npi;
+   h.npo = Npo;
+   h.maxlevel = Maxlevel;
+   for(i = 0; i < Nnodes; i++) h.nfan += Node[i].fin;
+   h.srcsize = Cachesize;
+   h.srchash = Cachehash;
+   fwrite(&h, sizeof(h), 1, fd);
+
+   a = (int *) malloc((Nnodes + h.nfan + 1) * sizeof(int));
+   for(i = 0; i < Nnodes; i++) a[i] = Node[i].num;
+   fwrite(a, sizeof(int), Nnodes, fd);
+   for(i = 0; i < Nnodes; i++) a[i] = Node[i].type;
+   fwrite(a, sizeof(int), Nnodes, fd);
+   for(i = 0; i < Nnodes; i++) a[i] = Node[i].level;
+   fwrite(a, sizeof(int), Nnodes, fd);
+   for(i = 0, a[0] = 0; i < Nnodes; i++) a[i + 1] = a[i] + Node[i].fin;
+   fwrite(a, sizeof(int), Nnodes + 1, fd);
+   for(i = 0, j = 0; i < Nnodes; i++)
+      for(j = 0; j < Node[i].fin; j++) a[Node[i].unodes - Upool + j] = Node[i].unodes[j]->indx;
+   fwrite(a, sizeof(int), h.nfan, fd);
+   for(i = 0, a[0] = 0; i < Nnodes; i++) a[i + 1] = a[i] + Node[i].fout;
+   fwrite(a, sizeof(int), Nnodes + 1, fd);
+   for(i = 0; i < Nnodes; i++)
+      for(j = 0; j < Node[i].fout; j++) a[Node[i].dnodes - Dpool + j] = Node[i].dnodes[j]->indx;
+   fwrite(a, sizeof(int), h.nfan, fd);
+   for(i = 0; i < Npi; i++) a[i] = Pinput[i]->indx;
+   fwrite(a, sizeof(int), Npi, fd);
+   for(i = 0; i < Npo; i++) a[i] = Poutput[i]->indx;
+   fwrite(a, sizeof(int), Npo, fd);
+   fwrite(Lorder, sizeof(int), Nnodes, fd);
+   fwrite(Loffset, sizeof(int), Maxlevel + 2, fd);
+   fwrite(Cc0, sizeof(int), Nnodes, fd);
+   fwrite(Cc1, sizeof(int), Nnodes, fd);
+   fwrite(Co, sizeof(int), Nnodes, fd);
+   free(a);
+   if(fclose(fd) == 0) rename(tmp, Cachename);
+   else remove(tmp);
+}
+
+/*-----------------------------------------------------------------------
+input: circuit description file name
+output: 1 on success, 0 on error
 called by: main
 description:
   This routine reads in the circuit description file and set up all the
-  required data structure. It first checks if the file exists, then it
-  sets up a mapping table, determines the number of nodes, PI's and PO's,
-  allocates dynamic data arrays, and fills in the structural information
-  of the circuit. In the ISCAS circuit description format, only upstream
-  nodes are specified. Downstream nodes are implied. However, to facilitate
+  required data structure. The file is mapped into memory and hashed;
+  if "<file>.fsc" holds a compiled netlist of the same text it is loaded
+  instead (see load_cache). Otherwise the text is parsed in a single
+  pass with scan_int: every record is appended to growing arrays and
+  numbered in order of appearance, and its fanins are kept as line
+  numbers in one flat array. A mapping table from line number to node
+  index then resolves the fanins, and build_nodes derives the fanouts.
+  In the ISCAS circuit description format, only upstream nodes are
+  specified. Downstream nodes are implied. However, to facilitate
   forward implication, they are also built up in the data structure.
-  To have the maximal flexibility, three passes through the circuit file
-  are required: the first pass to determine the size of the mapping table
-  , the second to fill in the mapping table, and the third to actually
-  set up the circuit information. These procedures may be simplified in
-  the future.
+  The cache is written by the next successful LEV.
 -----------------------------------------------------------------------*/
 cread(cp)
 char *cp;
 {
-   char buf[MAXLINE];
-   int ntbl, *tbl, i, j, k, nd, tp, fo, fi, ni = 0, no = 0;
+   char buf[MAXLINE], *text, *p, *end;
+   int ntbl, *tbl, i, k, nd, tp, ni = 0, no = 0;
+   int n, cap, fcap, nfan, mapped, *rnum, *rtype, *rfoff, *fan, *pil, *pol;
+   uint64_t hash;
+   struct stat st;
    FILE *fd;
-   NSTRUC *np;
 
    sscanf(cp, "%s", buf);
    if((fd = fopen(buf,"r")) == NULL) {
       printf("File %s does not exist!\n", buf);
-      return;
+      return 0;
    }
-   if(Gstate >= CKTLD) clear();
-   Nnodes = Npi = Npo = ntbl = 0;
-   while(fgets(buf, MAXLINE, fd) != NULL) {
-      if(sscanf(buf,"%d %d", &tp, &nd) == 2) {
-         if(ntbl < nd) ntbl = nd;
-         Nnodes ++;
-         if(tp == PI) Npi++;
-         else if(tp == PO) Npo++;
-      }
+   fstat(fileno(fd), &st);
+   text = (st.st_size > 0) ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fd), 0) : MAP_FAILED;
+   mapped = (text != MAP_FAILED);
+   if(!mapped) {                                /* empty file or no mmap */
+      text = malloc(st.st_size + 1);
+      st.st_size = fread(text, 1, st.st_size, fd);
    }
-   tbl = (int *) malloc(++ntbl * sizeof(int));
+   else madvise(text, st.st_size, MADV_SEQUENTIAL);
+   fclose(fd);
+   p = text;
+   end = text + st.st_size;
+   hash = text_hash(text, st.st_size);
+   if(Gstate >= CKTLD) clear();
 
-   fseek(fd, 0L, 0);
-   i = 0;
-   while(fgets(buf, MAXLINE, fd) != NULL) {
-      if(sscanf(buf,"%d %d", &tp, &nd) == 2) tbl[nd] = i++;
+   sprintf(Cachename, "%s.fsc", buf);
+   if(load_cache(Cachename, hash, st.st_size)) {
+      if(mapped) munmap(text, st.st_size);
+      else free(text);
+      build_csr();
+      Gstate = CKTLEV;
+      if(Verbose >= 1) printf("==> OK (compiled netlist %s)\n", Cachename);
+      return 1;
    }
-   allocate();
+   Cachehash = hash;
+   Cachesize = st.st_size;
+   Cachepending = 1;
 
-   fseek(fd, 0L, 0);
-   while(fscanf(fd, "%d %d", &tp, &nd) != EOF) {
-      np = &Node[tbl[nd]];
-      np->num = nd;
-      if(tp == PI) Pinput[ni++] = np;
-      else if(tp == PO) Poutput[no++] = np;
+   /* single pass over the records */
+   n = nfan = ntbl = 0;
+   cap = fcap = 1024;
+   rnum = (int *) malloc(cap * sizeof(int));
+   rtype = (int *) malloc(cap * sizeof(int));
+   rfoff = (int *) malloc((cap + 1) * sizeof(int));
+   fan = (int *) malloc(fcap * sizeof(int));
+   Npi = Npo = 0;
+   while(scan_int(&p, end, &tp) && scan_int(&p, end, &nd)) {
+      if(n == cap) {
+         cap *= 2;
+         rnum = (int *) realloc(rnum, cap * sizeof(int));
+         rtype = (int *) realloc(rtype, cap * sizeof(int));
+         rfoff = (int *) realloc(rfoff, (cap + 1) * sizeof(int));
+      }
+      rnum[n] = nd;
+      if(nd < 0) {
+         printf("Negative line number %d!\n", nd);
+         exit(-1);
+      }
+      if(ntbl < nd) ntbl = nd;
       switch(tp) {
          case PI:
          case PO:
          case GATE:
-            fscanf(fd, "%d %d %d", &np->type, &np->fout, &np->fin);
+            scan_int(&p, end, &rtype[n]);
+            scan_int(&p, end, &k);              /* fanout count is implied */
+            scan_int(&p, end, &k);
+            if(tp == PI) Npi++;
+            else if(tp == PO) Npo++;
             break;
-         
+
          case FB:
-            np->fout = np->fin = 1;
-            fscanf(fd, "%d", &np->type);
+            k = 1;
+            scan_int(&p, end, &rtype[n]);
             break;
 
          default:
             printf("Unknown node type!\n");
             exit(-1);
-         }
-      np->unodes = (NSTRUC **) malloc(np->fin * sizeof(NSTRUC *));
-      np->dnodes = (NSTRUC **) malloc(np->fout * sizeof(NSTRUC *));
-      for(i = 0; i < np->fin; i++) {
-         fscanf(fd, "%d", &nd);
-         np->unodes[i] = &Node[tbl[nd]];
-         }
-      for(i = 0; i < np->fout; np->dnodes[i++] = NULL);
       }
-   for(i = 0; i < Nnodes; i++) {
-      for(j = 0; j < Node[i].fin; j++) {
-         np = Node[i].unodes[j];
-         k = 0;
-         while(np->dnodes[k] != NULL) k++;
-         np->dnodes[k] = &Node[i];
-         }
+      rtype[n] |= tp << 8;
+      rfoff[n] = nfan;
+      if(nfan + k > fcap) {
+         while(nfan + k > fcap) fcap *= 2;
+         fan = (int *) realloc(fan, fcap * sizeof(int));
       }
-   fclose(fd);
+      for(i = 0; i < k; i++) scan_int(&p, end, &fan[nfan++]);
+      n++;
+   }
+   rfoff[n] = nfan;
+   if(mapped) munmap(text, st.st_size);
+   else free(text);
+
+   tbl = (int *) arena_alloc(&Runarena, ++ntbl * sizeof(int));
+   for(i = 0; i < ntbl; i++) tbl[i] = -1;
+   for(i = 0; i < n; i++) tbl[rnum[i]] = i;
+   for(i = 0; i < nfan; i++) {
+      if(fan[i] < 0 || fan[i] >= ntbl || tbl[fan[i]] < 0) {
+         printf("Line %d is used but never defined!\n", fan[i]);
+         Nnodes = Npi = Npo = 0;
+         Cachepending = 0;
+         free(rnum); free(rtype); free(rfoff); free(fan);
+         return 0;
+      }
+      fan[i] = tbl[fan[i]];
+   }
+   pil = (int *) arena_alloc(&Runarena, (Npi + 1) * sizeof(int));
+   pol = (int *) arena_alloc(&Runarena, (Npo + 1) * sizeof(int));
+   for(i = 0; i < n; i++) {
+      tp = rtype[i] >> 8;
+      rtype[i] &= 0xff;
+      if(tp == PI) pil[ni++] = i;
+      else if(tp == PO) pol[no++] = i;
+   }
+   build_nodes(n, rnum, rtype, rfoff, fan, NULL, NULL, pil, pol);
+   free(rnum);
+   free(rtype);
+   free(rfoff);
+   free(fan);
    Gstate = CKTLD;
-   printf("==> OK\n");
+   if(Verbose >= 1) printf("==> OK\n");
    return 1;
 }
 
@@ -299,10 +1042,44 @@ help()
    printf("print circuit information\n");
    printf("LEV - ");
    printf("level circuit lines\n");
-   printf("GFL - ");
-   printf("Generate collapsed fault list\n");
-   printf("PFS - ");
+   printf("GFL [checkpoint] - ");
+   printf("Generate collapsed fault list (equivalence/dominance or checkpoints)\n");
+   printf("PFS patfile [outfile] - ");
    printf("Parallel fault simulator\n"); 
+   printf("DFS [patfile [outfile]] - ");
+   printf("Deductive fault simulator, sparse fault lists\n");
+   printf("BDFS patfile [outfile] - ");
+   printf("Deductive fault simulator, bitset fault lists\n");
+   printf("CFS patfile [outfile] - ");
+   printf("Event-driven concurrent fault simulator with fault dropping\n");
+   printf("PPSFP patfile [outfile] - ");
+   printf("Parallel-pattern single-fault propagation with fault dropping\n");
+   printf("MTFS nthreads patfile [outfile] - ");
+   printf("Multithreaded PPSFP with work stealing over the fault list\n");
+   printf("MTSIM nthreads patfile outfile - ");
+   printf("Multithreaded bit-parallel fault free simulation\n");
+   printf("FFS [pattern] - ");
+   printf("fault free simulation of one pattern (PIs default to 0)\n");
+   printf("PSIM patfile [outfile] - ");
+   printf("bit-parallel fault free simulation of a pattern file\n");
+   printf("PACK patfile binfile - ");
+   printf("convert a pattern file to the packed binary format\n");
+   printf("CSIM patfile [outfile] - ");
+   printf("PSIM with the netlist compiled to C and loaded at run time\n");
+   printf("ATPG testfile [backtrack_limit] [podem|sat] [random [N K]] [compact] - ");
+   printf("PODEM test generation, aborted faults go to SAT, with fault dropping\n");
+   printf("COMPACT testfile - ");
+   printf("static compaction of the last ATPG test set\n");
+   printf("SCOAP [nfaults] [hard|easy|none] - ");
+   printf("testability report, order the target faults by SCOAP cost\n");
+   printf("GEN ckt_file ngates [npi [levels [fanout [reconvergence%% [seed]]]]] - ");
+   printf("write a synthetic circuit\n");
+   printf("BENCH ckt_file [npatterns] [jsonfile] [engine ...] - ");
+   printf("time parsing, levelization and the engines on a circuit\n");
+   printf("STATS [reset|jsonfile] - ");
+   printf("phase timers and hot-path counters, optionally as JSON\n");
+   printf("VERBOSE level [node[/sa]] - ");
+   printf("0 quiet, 1 summaries, 2 node/fault listings, 3 traces (-DFSIMTRACE builds)\n");
    printf("HELP - ");
    printf("print this help information\n");
    printf("QUIT - ");
@@ -323,26 +1100,106 @@ quit()
    return 1;
 }
 
+/*-----------------------------------------------------------------------
+input: verbosity level, optional node line number with optional /0 or /1
+output: 1 on success, 0 on a bad argument
+called by: main
+description:
+  Set the verbosity of the commands. Level 0 prints nothing but errors,
+  1 the summary of each command, 2 also the per-node and per-fault
+  listings of GFL, FFS and DFS, and 3 also the kernel traces of a build
+  compiled with -DFSIMTRACE. A node restricts the traces to that node and a
+  node/sa to that single fault.
+-----------------------------------------------------------------------*/
+int verbose(cp)
+char *cp;
+{
+   int n, level, num, sa, i;
+
+   n = sscanf(cp, "%d %d/%d", &level, &num, &sa);
+   if(n < 1 || level < 0 || (n == 3 && sa != 0 && sa != 1)) {
+      printf("Usage: VERBOSE level [node[/sa]]\n");
+      return 0;
+   }
+   Tnode = Tfault = -1;
+   if(n >= 2) {
+      for(i = 0; i < Nnodes && Node[i].num != num; i++);
+      if(i == Nnodes) {
+         printf("Node %d does not exist!\n", num);
+         return 0;
+      }
+      Tnode = i;
+      if(n == 3) Tfault = 2 * i + sa;
+   }
+   Verbose = level;
+#ifndef FSIMTRACE
+   if(level >= 3) printf("Traces need a build with -DFSIMTRACE\n");
+#endif
+   return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: position (-1: any), fault id (-1: any)
+output: 1 if the trace point is selected by VERBOSE
+called by: TRACE
+description:
+  Filter of the kernel traces: the node and the fault set by VERBOSE.
+-----------------------------------------------------------------------*/
+int trace_on(int p, int fid)
+{
+   if(Tnode >= 0 && p >= 0 && Lorder[p] != Tnode) return 0;
+   if(Tfault >= 0 && fid >= 0 && fid != Tfault) return 0;
+   return 1;
+}
+
 /*-----------------------------------------------------------------------
 input: nothing
 output: nothing
 called by: cread
 description:
   This routine clears the memory space occupied by the previous circuit
-  before reading in new one. It frees up the dynamic arrays Node.unodes,
-  Node.dnodes, Node.flist, Node, Pinput, Poutput, and Tap.
+  before reading in new one. Node, the pools, the schedule, the CSR
+  arrays and everything else sized by the circuit live in Netarena and
+  go with it in one call; the run and pattern arenas are returned too.
+  The pointers into the arenas are reset so that the lazily allocated
+  arrays are made again for the next circuit. The scratch lists of the
+  deductive simulator, the test set and the SAT solver grow by realloc
+  and are freed one by one.
 -----------------------------------------------------------------------*/
 clear()
 {
-   int i;
-
-   for(i = 0; i<Nnodes; i++) {
-      free(Node[i].unodes);
-      free(Node[i].dnodes);
-   }
-   free(Node);
-   free(Pinput);
-   free(Poutput);
+   arena_free(&Netarena);
+   arena_free(&Runarena);
+   arena_free(&Patarena);
+   if(Csimlib) dlclose(Csimlib);
+   free(Ltmp[0]);
+   free(Ltmp[1]);
+   free(Tset);
+   free(Tcube);
+   sat_free();
+   Node = NULL;
+   Pinput = Poutput = NULL;
+   Upool = Dpool = NULL;
+   Cpos = Clevel = NULL;
+   Ctype = Cval = NULL;
+   Cfin = Cfout = Cfan = Cdfan = Cpi = Cpo = NULL;
+   CompleteFL = CollapsedFL = NULL;
+   Flist = NULL;
+   Ltmp[0] = Ltmp[1] = NULL;
+   Ncollapsed = Nflist = Ltmpsize = 0;
+   Sfv = NULL;
+   Cc0 = Cc1 = Co = NULL;
+   Ag = Af = NULL;
+   Ainq = Fstat = Tset = Tcube = NULL;
+   Aqueue = Aqn = Acone = Astamp = Astack = Axq = Axstamp = NULL;
+   Ntset = Tcap = 0;
+   Csimlib = NULL;
+   Csimfn = NULL;
+   Pval = NULL;
+   Pomark = NULL;
+   Dfl = NULL;
+   Dfn = NULL;
+   Lorder = Loffset = NULL;
    Gstate = EXEC;
 }
 
@@ -353,16 +1210,16 @@ called by: cread
 description:
   This routine allocatess the memory space required by the circuit
   description data structure. It allocates the dynamic arrays Node,
-  Node.flist, Node, Pinput, Poutput, and Tap. It also set the default
-  tap selection and the fanin and fanout to 0.
+  Pinput and Poutput from Netarena. It also set the fanin and fanout
+  to 0.
 -----------------------------------------------------------------------*/
 allocate()
 {
    int i;
 
-   Node = (NSTRUC *) malloc(Nnodes * sizeof(NSTRUC));
-   Pinput = (NSTRUC **) malloc(Npi * sizeof(NSTRUC *));
-   Poutput = (NSTRUC **) malloc(Npo * sizeof(NSTRUC *));
+   Node = (NSTRUC *) arena_zalloc(&Netarena, Nnodes * sizeof(NSTRUC));
+   Pinput = (NSTRUC **) arena_alloc(&Netarena, Npi * sizeof(NSTRUC *));
+   Poutput = (NSTRUC **) arena_alloc(&Netarena, Npo * sizeof(NSTRUC *));
    for(i = 0; i<Nnodes; i++) {
       Node[i].indx = i;
       Node[i].fin = Node[i].fout = 0;
@@ -394,513 +1251,4843 @@ int tp;
 
 /*-----------------------------------------------------------------------
 input: nothing
-output: nothing
+output: 1 on success, 0 if the circuit has a combinational loop
 called by: main
 description:
-  Realize levelization of each circuit line after READ command.
+  Realize levelization of each circuit line after READ command. Nodes
+  without fanins are queued at level 0, and a node is queued once its
+  last fanin has been levelized (Kahn's algorithm), which takes
+  O(nodes + edges). The level of a node is one more than the maximum
+  level of its fanins. The per-level node counts gathered on the way
+  give the evaluation schedule Lorder/Loffset used by the simulators.
+  Nodes that never become ready lie on or behind a loop and are reported.
+  The first successful LEV after a READ also writes the compiled netlist
+  cache (see write_cache).
 -----------------------------------------------------------------------*/
 lev()
 {
-   NSTRUC *np;
-   char *gname();
-   int i,j,k,m,maxlev;
-   bool correct = 0;
-   int sumnode = 0;
+   NSTRUC *np, *dp;
+   int i, j, head, tail;
+   int *queue, *pending;
 
+   queue = (int *) arena_alloc(&Runarena, Nnodes * sizeof(int));
+   pending = (int *) arena_alloc(&Runarena, Nnodes * sizeof(int));
+   if(Lorder == NULL) {
+      Lorder = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+      Loffset = (int *) arena_alloc(&Netarena, (Nnodes + 2) * sizeof(int));
+   }
+   memset(Loffset, 0, (Nnodes + 2) * sizeof(int));
    Maxlevel = 0;
+   head = tail = 0;
+   for(i = 0; i < Nnodes; i++) {
+      np = &Node[i];
+      np->level = 0;
+      np->islevel = 0;
+      pending[i] = np->fin;
+      if(np->fin == 0) queue[tail++] = i;
+   }
+   while(head < tail) {
+      np = &Node[queue[head++]];
+      np->islevel = 1;
+      Loffset[np->level + 1]++;
+      if(np->level > Maxlevel) Maxlevel = np->level;
+      for(j = 0; j < np->fout; j++) {
+         dp = np->dnodes[j];
+         if(dp->level <= np->level) dp->level = np->level + 1;
+         if(--pending[dp->indx] == 0) queue[tail++] = dp->indx;
+      }
+   }
 
-   while (1) {
-       for(i = 0; i<Nnodes; i++) {
-        np = &Node[i];
-        if (np->islevel == 0) {
-          if (np->type == 0) {
-            np->level = 0;
-            np->islevel = 1;
-            sumnode++;
-          }
-          else if (np->type == 1) {
-            if (np->unodes[0]->islevel == 1) {
-              np->level = np->unodes[0]->level + 1;
-              np->islevel = 1;
-              sumnode++;
-              if ((np->unodes[0]->level + 1) > Maxlevel){
-                Maxlevel = np->unodes[0]->level + 1;
-              }
-            }         
-          }
-          else {
-            maxlev = 0;
-            correct = 1;
-            for (j = 0; j<np->fin; j++) {
-              if (np->unodes[j]->islevel == 1) {
-                if (np->unodes[j]->level >= maxlev) {
-                  maxlev = np->unodes[j]->level;
-                }
-              }
-              else { 
-                correct = 0; //some fins are not leveled.
-                break;
-              }             
-            }
-            if (correct) {
-              np->level = maxlev + 1;
-              np->islevel = 1;
-              sumnode++;
-              if (np->level > Maxlevel) {
-                Maxlevel = np->level;
-              }
-            }
-            //printf("maxlev = %d\n", maxlev);
-          }
-      }   
-    }
-    if (sumnode == Nnodes) break;
+   if(tail < Nnodes) {
+      printf("Combinational loop: %d nodes cannot be levelized:", Nnodes - tail);
+      for(i = 0, j = 0; i < Nnodes && j < 20; i++)
+         if(!Node[i].islevel) {
+            printf(" %d", Node[i].num);
+            j++;
+         }
+      printf("%s\n", (Nnodes - tail > 20) ? " ..." : "");
+      Gstate = CKTLD;
+      return 0;
    }
 
-   printf("==> OK\n");
+   /* per-level counts to offsets, then place the nodes level by level */
+   for(i = 0; i <= Maxlevel; i++) Loffset[i + 1] += Loffset[i];
+   for(i = 0; i <= Maxlevel; i++) pending[i] = Loffset[i];
+   for(i = 0; i < Nnodes; i++) Lorder[pending[Node[i].level]++] = i;
+
+   build_csr();
+   scoap();
+   Gstate = CKTLEV;
+   if(Cachepending) write_cache();
+   if(Verbose >= 1) printf("==> OK\n");
+   return 1;
 }
 
 /*-----------------------------------------------------------------------
 input: nothing
 output: nothing
+called by: lev, cread
+description:
+  Build the structure-of-arrays netlist the simulators run on. Nodes are
+  renumbered in level order (position p is Node[Lorder[p]]), types and
+  levels go to separate arrays, and fanins and fanouts become CSR index
+  arrays of positions. A level-order sweep then reads every array front
+  to back, and the hot values of the simulators are plain arrays indexed
+  by position instead of fields of the fat NSTRUC. The arrays are taken
+  from Netarena on the first call after a READ and refilled in place by
+  a later LEV, whose fanin counts are the same.
+-----------------------------------------------------------------------*/
+void build_csr()
+{
+   NSTRUC *np;
+   int i, j, p, nfan;
+
+   if(Cpos == NULL) {
+      for(i = nfan = 0; i < Nnodes; i++) nfan += Node[i].fin;
+      Cpos = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+      Ctype = (uint8_t *) arena_alloc(&Netarena, Nnodes);
+      Clevel = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+      Cfin = (uint32_t *) arena_alloc(&Netarena, (Nnodes + 1) * sizeof(uint32_t));
+      Cfout = (uint32_t *) arena_alloc(&Netarena, (Nnodes + 1) * sizeof(uint32_t));
+      Cfan = (uint32_t *) arena_alloc(&Netarena, (nfan + 1) * sizeof(uint32_t));
+      Cdfan = (uint32_t *) arena_alloc(&Netarena, (nfan + 1) * sizeof(uint32_t));
+      Cpi = (uint32_t *) arena_alloc(&Netarena, (Npi + 1) * sizeof(uint32_t));
+      Cpo = (uint32_t *) arena_alloc(&Netarena, (Npo + 1) * sizeof(uint32_t));
+      Cval = (uint8_t *) arena_alloc(&Netarena, Nnodes);
+   }
+   memset(Cval, 0, Nnodes);
+   for(p = 0; p < Nnodes; p++) Cpos[Lorder[p]] = p;
+   Cfin[0] = Cfout[0] = 0;
+   for(p = 0; p < Nnodes; p++) {
+      np = &Node[Lorder[p]];
+      Ctype[p] = np->type;
+      Clevel[p] = np->level;
+      Cfin[p + 1] = Cfin[p] + np->fin;
+      for(j = 0; j < np->fin; j++) Cfan[Cfin[p] + j] = Cpos[np->unodes[j]->indx];
+      Cfout[p + 1] = Cfout[p] + np->fout;
+      for(j = 0; j < np->fout; j++) Cdfan[Cfout[p] + j] = Cpos[np->dnodes[j]->indx];
+   }
+   for(i = 0; i < Npi; i++) Cpi[i] = Cpos[Pinput[i]->indx];
+   for(i = 0; i < Npo; i++) Cpo[i] = Cpos[Poutput[i]->indx];
+}
+
+/*-----------------------------------------------------------------------
+input: optional "checkpoint"
+output: nothing
 called by: main
 description:
-  
+  Generate the complete single stuck-at fault list (SA0 and SA1 on every
+  line) and collapse it into CollapsedFL. Both lists are taken from
+  Netarena once per circuit and overwritten by a repeated GFL.
+  By default the faults are collapsed structurally. Equivalent faults
+  are merged with a union-find over fault ids 2 * indx + stuck value:
+  an input SA0 of an AND is equivalent to its output SA0, of a NAND to
+  its output SA1, an input SA1 of an OR to its output SA1, of a NOR to
+  its output SA0, and the input faults of NOT and BRCH to the opposite
+  and same output faults. An input line takes part only when it feeds
+  this gate alone and is not a primary output; a fanout stem and its
+  branches are different lines. Then dominance removes the class of the
+  output SA1 of every AND with two or more inputs (SA0 of NAND and OR,
+  SA1 of NOR), since any test of an input SA1 (SA0 for OR/NOR) detects
+  it. One fault of every remaining class is kept.
+  With "checkpoint" the list is the checkpoint faults instead: SA0 and
+  SA1 on the primary inputs and the fanout branches.
 -----------------------------------------------------------------------*/
-preprocessor()
+preprocessor(cp)
+char *cp;
 {
   FAULTLIST   *fp;
-  NSTRUC      *np;
-  int         i, Cpoints;
+  NSTRUC      *np, *up;
+  char        mode[MAXLINE], *ispo, *drop;
+  int         i, j, ncp, nfault, *uf;
+  int         eq0, eq1;       /* output fault equivalent to input SA0/SA1, -1: none */
+  int         dom;            /* output stuck value removed by dominance, -1: none */
 
-  Cpoints = 0;
-
-  CompleteFL = (FAULTLIST *) malloc(Nnodes * sizeof(FAULTLIST));
-  printf("Complete single stuck-at-fault list:\n");  
+  if (sscanf(cp, "%s", mode) != 1) mode[0] = '\0';
+  if (CompleteFL == NULL) {
+    CompleteFL = (FAULTLIST *) arena_alloc(&Netarena, Nnodes * sizeof(FAULTLIST));
+    CollapsedFL = (FAULTLIST *) arena_alloc(&Netarena, Nnodes * sizeof(FAULTLIST));
+  }
+  if (Verbose >= 2) printf("Complete single stuck-at-fault list:\n");
   for (i = 0; i < Nnodes; i++) {
-    np = &Node[i];
     fp = &CompleteFL[i];
     fp->indx = i;
-    if ((np->type == 0) | (np->type == 1)){
-      Cpoints++;
-
-    }
-    printf("\tNode %d: (s_a_0, s_a_1)\t", i+1);
     fp->s_a_0 = 1;
     fp->s_a_1 = 1;
-    if ((i+1)%2 == 0) printf("\n");
+    if (Verbose >= 2) {
+      printf("\tNode %d: (s_a_0, s_a_1)\t", i+1);
+      if ((i+1)%2 == 0) printf("\n");
+    }
   }
 
-  printf("\nCollapsed single stuck-at-fault list:\n");
-  CollapsedFL = (FAULTLIST *) malloc(Cpoints * sizeof(FAULTLIST));
-
-
+  if (Verbose >= 2) printf("\nCollapsed single stuck-at-fault list:\n");
+  drop = (char *) arena_zalloc(&Runarena, 2 * Nnodes);
+  if (strcmp(mode, "checkpoint") == 0) {
+    for (i = 0; i < Nnodes; i++)
+      if (Node[i].type != IPT && Node[i].type != BRCH) drop[2 * i] = drop[2 * i + 1] = 1;
+  }
+  else {
+    ispo = (char *) arena_zalloc(&Runarena, Nnodes);
+    for (i = 0; i < Npo; i++) ispo[Poutput[i]->indx] = 1;
+    uf = (int *) arena_alloc(&Runarena, 2 * Nnodes * sizeof(int));
+    for (i = 0; i < 2 * Nnodes; i++) uf[i] = i;
+    for (i = 0; i < Nnodes; i++) {
+      np = &Node[i];
+      eq0 = eq1 = -1;
+      switch (np->type) {
+        case BRCH: eq0 = 0; eq1 = 1; break;
+        case NOT:  eq0 = 1; eq1 = 0; break;
+        case AND:  eq0 = 0; break;
+        case NAND: eq0 = 1; break;
+        case OR:   eq1 = 1; break;
+        case NOR:  eq1 = 0; break;
+        default:   break;
+      }
+      for (j = 0; j < np->fin; j++) {
+        up = np->unodes[j];
+        if (up->fout != 1 || ispo[up->indx]) continue;
+        if (eq0 >= 0) uf_union(uf, 2 * up->indx, 2 * i + eq0);
+        if (eq1 >= 0) uf_union(uf, 2 * up->indx + 1, 2 * i + eq1);
+      }
+    }
+    for (i = 0; i < 2 * Nnodes; i++)
+      if (uf_find(uf, i) != i) drop[i] = 1;
+    for (i = 0; i < Nnodes; i++) {
+      np = &Node[i];
+      dom = (np->type == AND || np->type == NOR) ? 1 :
+            (np->type == NAND || np->type == OR) ? 0 : -1;
+      if (dom >= 0 && np->fin >= 2) drop[uf_find(uf, 2 * i + dom)] = 1;
+    }
+  }
 
+  Ncollapsed = nfault = 0;
+  for (i = ncp = 0; i < Nnodes; i++) {
+    if (drop[2 * i] && drop[2 * i + 1]) continue;
+    fp = &CollapsedFL[Ncollapsed++];
+    fp->indx = i;
+    fp->s_a_0 = !drop[2 * i];
+    fp->s_a_1 = !drop[2 * i + 1];
+    nfault += fp->s_a_0 + fp->s_a_1;
+    if (Verbose >= 2) {
+      printf("\tNode %d: (%s)\t", i+1, !fp->s_a_0 ? "s_a_1" : !fp->s_a_1 ? "s_a_0" : "s_a_0, s_a_1");
+      if (++ncp % 2 == 0) printf("\n");
+    }
+  }
+  if (Verbose >= 1) printf("%s==> %d faults, %d after %s collapsing (%.1f%%)\n",
+         Verbose >= 2 ? "\n" : "", 2 * Nnodes, nfault,
+         mode[0] ? "checkpoint" : "equivalence/dominance",
+         Nnodes ? 100.0 * nfault / (2 * Nnodes) : 0.0);
+  return 1;
+}
 
+/*-----------------------------------------------------------------------
+input: union-find parent array, element
+output: representative of the element's class
+called by: preprocessor
+description:
+  Find with path halving.
+-----------------------------------------------------------------------*/
+int uf_find(int *uf, int x)
+{
+  while (uf[x] != x) {
+    uf[x] = uf[uf[x]];
+    x = uf[x];
+  }
+  return x;
 }
 
+/*-----------------------------------------------------------------------
+input: union-find parent array, two elements
+output: nothing
+called by: preprocessor
+description:
+  Merge the classes of x and y. The smaller fault id becomes the
+  representative, so the collapsed list does not depend on the order
+  of the merges.
+-----------------------------------------------------------------------*/
+void uf_union(int *uf, int x, int y)
+{
+  x = uf_find(uf, x);
+  y = uf_find(uf, y);
+  if (x < y) uf[y] = x;
+  else uf[x] = y;
+}
 
 /*-----------------------------------------------------------------------
 input: nothing
-output: nothing
-called by: main
+output: number of target faults, -1 if no fault list has been generated
+called by: pfs
 description:
-  
+  Expand the collapsed fault list (or the complete one while nothing has
+  been collapsed) into Flist, one fault id 2 * indx + stuck value per
+  single stuck-at fault, in SCOAP cost order if SCOAP asked for one.
 -----------------------------------------------------------------------*/
-pfs()
+int build_target_faults()
 {
+  FAULTLIST *fl;
+  int i, n;
 
+  if (CompleteFL == NULL) {
+    printf("Fault list not generated, run GFL first!\n");
+    return -1;
+  }
+  if (Ncollapsed > 0) {
+    fl = CollapsedFL;
+    n = Ncollapsed;
+  }
+  else {
+    fl = CompleteFL;
+    n = Nnodes;
+  }
+  if (Flist == NULL) Flist = (int *) arena_alloc(&Netarena, 2 * Nnodes * sizeof(int));
+  Nflist = 0;
+  for (i = 0; i < n; i++) {
+    if (fl[i].s_a_0) Flist[Nflist++] = 2 * fl[i].indx;
+    if (fl[i].s_a_1) Flist[Nflist++] = 2 * fl[i].indx + 1;
+  }
+  if (Forder) {
+    qsort(Flist, Nflist, sizeof(int), fault_cmp);
+    for (i = 0; Forder < 0 && i < Nflist / 2; i++) {
+      n = Flist[i];
+      Flist[i] = Flist[Nflist - 1 - i];
+      Flist[Nflist - 1 - i] = n;
+    }
+  }
+  return Nflist;
 }
 
-/*========================= End of program ============================*/
-fault_free_simulation(){
-  int i,j,k;
-  int *fault_free_output;       /*the array of the fault free simulation's output */
+/*-----------------------------------------------------------------------
+input: pattern file name, optional report file name
+output: nothing
+called by: main
+description:
+  Parallel fault simulator. Bit 0 of every node word carries the good
+  machine and bits 1..63 carry 63 faulty machines. Faults are injected
+  through the per-node masks Fmask0/Fmask1 right after the node is
+  evaluated, and the word is swept over the target fault list 63 faults
+  at a time for every pattern. A fault is detected when its bit differs
+  from the good bit on some primary output. The detected faults of each
+  pattern are reported as node/stuck value.
+-----------------------------------------------------------------------*/
+pfs(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE], *pat, *hit;
+  FILE *fd, *fo;
+  int i, j, f, g, n, npat, ndet;
+  uint64_t diff, good;
 
-  fault_free_output = (int*)malloc(sizeof(int)*Npo);
-  NSTRUC *np;
+  n = sscanf(cp, "%s %s", fin, fout);
+  if (n < 1) {
+    printf("Usage: PFS patfile [outfile]\n");
+    return 0;
+  }
+  if (build_target_faults() < 0) return 0;
+  if ((fd = fopen(fin, "r")) == NULL) {
+    printf("File %s does not exist!\n", fin);
+    return 0;
+  }
+  fo = stdout;
+  if (n == 2 && (fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    fclose(fd);
+    return 0;
+  }
+  if (Pval == NULL) Pval = (uint64_t *) arena_alloc(&Netarena, Nnodes * PWORDS * sizeof(uint64_t));
+  Fmask0 = (uint64_t *) arena_zalloc(&Runarena, Nnodes * sizeof(uint64_t));
+  Fmask1 = (uint64_t *) arena_zalloc(&Runarena, Nnodes * sizeof(uint64_t));
+  pat = arena_alloc(&Runarena, Npi + 1);
+  hit = arena_zalloc(&Runarena, Nflist);
+  npat = ndet = 0;
 
-  for (i=0; i<Npi; i++){
-    Pinput[i]->node_value = 0;        /*PI read the test pattern generated from ATPG???????*/
-    printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",Pinput[i]->num, Pinput[i]->indx, gname(Pinput[i]->type), Pinput[i]->level, Pinput[i]->node_value);
-  }
-
-  for (i=1; i<=Maxlevel; i++){
-    for (j=0; j<Nnodes; j++){
-      np = &Node[j];
-      if (np->level==i){
-        switch(np->type){
-          case 0:
-              np->node_value = 1;
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          case 1://Branch
-              np->node_value  = np->unodes[0]->node_value ;
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          case 2://XOR
-              np->node_value  = 0;
-               for (k=0; k<np->fin; k++){
-                np->node_value  = np->unodes[k]->node_value  ^ np->node_value ;
-              }
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          case 3://OR
-              np->node_value = 0;
-              for (k=0; k<np->fin; k++){
-                if (np->unodes[k]->node_value ==1)
-                  np->node_value  = 1;
-              }
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          case 4://NOR
-              np->node_value = 1;
-              for (k=0; k<np->fin; k++){
-                if (np->unodes[k]->node_value ==1)
-                  np->node_value  = 0;
-              }
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          case 5://NOT
-              np->node_value  = !(np->unodes[0]->node_value);
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          case 6://NAND
-              np->node_value = 0;
-              for (k=0; k<np->fin; k++){
-                if (np->unodes[k]->node_value ==0)
-                  np->node_value  = 1;
-              }
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          case 7://AND
-              np->node_value = 1;
-              for (k=0; k<np->fin; k++){
-                if (np->unodes[k]->node_value ==0)
-                  np->node_value  = 0;
-              }
-              printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, np->node_value);
-              break;
-          default:
-              np->node_value = 2;
+  while (read_pattern(fd, pat)) {
+    fprintf(fo, "pattern %d:", npat++);
+    for (f = 0; f < Nflist; f += 63) {
+      n = (Nflist - f < 63) ? Nflist - f : 63;
+      for (g = 0; g < n; g++) {
+        i = Cpos[Flist[f + g] >> 1];
+        if (Flist[f + g] & 1) Fmask1[i] |= 1ULL << (g + 1);
+        else Fmask0[i] |= 1ULL << (g + 1);
+      }
+      for (i = 0; i < Npi; i++)
+        Pval[Cpi[i]] = (pat[i] == '1') ? ~0ULL : 0;
+      for (j = 0; j < Nnodes; j++) {
+        eval_word(j, Pval, 1);
+        Pval[j] = (Pval[j] & ~Fmask0[j]) | Fmask1[j];
+      }
+      Stats.evals += Nnodes;
+      diff = 0;
+      for (i = 0; i < Npo; i++) {
+        good = Pval[Cpo[i]];
+        diff |= good ^ (0 - (good & 1));
+      }
+      for (g = 0; g < n; g++) {
+        i = Cpos[Flist[f + g] >> 1];
+        Fmask0[i] = Fmask1[i] = 0;
+        if ((diff >> (g + 1)) & 1) {
+          fprintf(fo, " %d/%d", Node[Flist[f + g] >> 1].num, Flist[f + g] & 1);
+          if (!hit[f + g]) {
+            hit[f + g] = 1;
+            ndet++;
+          }
         }
       }
     }
+    fprintf(fo, "\n");
   }
 
-  for(i=0; i<Npo; i++){
-    fault_free_output[i] = Poutput[i]->node_value;
-    printf("\n Node:%d indx:%d type:%s leval:%d fault_free_output: %d\n", Poutput[i]->num, Poutput[i]->indx, gname(Poutput[i]->type), Poutput[i]->level, fault_free_output[i]);
-  }
-
+  fclose(fd);
+  if (fo != stdout) fclose(fo);
+  if (Verbose >= 1)
+    printf("==> %d patterns, %d of %d faults detected (%.2f%%)\n", npat, ndet,
+           Nflist, Nflist ? 100.0 * ndet / Nflist : 0.0);
   return 1;
 }
 
-
-
-int* union_op(int*x, int*y){
-  int i;
-  int *z;
-  z = malloc(sizeof(int)*Nnodes);
-  for(i=0; i<Nnodes; i++){
-    if (x[i]==y[i]){
-      z[i] = x[i];
-      printf("z:%d\n",z[i]);
-    }
-    else{
-      if (x[i]==2)
-        z[i] = y[i];
-      else if (y[i]==2)
-        z[i] = x[i];
-      else if (x[i]==3)//non-exist case
-        z[i] = 3;
-      else if (y[i]==3)////non-exist case
-        z[i] = 3;
-      else 
-        z[i] = 3;
-      printf("z:%d\n",z[i]);
-    }
-  }
-  /*free(x);
-  free(y);
-  free(z);*/
-  return z;////?????????????????????
-}
-
-int* intersaction_op(int*x, int*y){
-  int i;
-  int *z;
-  z = malloc(sizeof(int)*Nnodes);
-  for(i=0; i<Nnodes; i++){
-    if (x[i]==y[i]){
-      z[i] = x[i];
-      printf("z:%d\n",z[i]);
-    }
-
-
-
-    else{
-      if((x[i]==3)&&(y[i]==1))
-        z[i]= 1;
-      if((x[i]==1)&&(y[i]==3))
-        z[i]= 1;
-      if((x[i]==3)&&(y[i]==0))
-        z[i]= 0;
-      if((x[i]==0)&&(y[i]==2))
-        z[i]= 0;
-      if((x[i]==2)&&(y[i]==1))
-        z[i]= 2;
-      if((x[i]==1)&&(y[i]==2))
-        z[i]= 2;
-      if((x[i]==2)&&(y[i]==0))
-        z[i]= 2;
-      if((x[i]==0)&&(y[i]==2))
-        z[i]= 2;
-      if((x[i]==2)&&(y[i]==3))
-        z[i]= 2;
-      if((x[i]==3)&&(y[i]==2))
-        z[i]= 2;
-      if((x[i]==2)&&(y[i]==3))
-        z[i]= 2;
-      if((x[i]==3)&&(y[i]==2))
-        z[i]= 2;
-    }
-    printf("z:%d\n",z[i]);
-   /*else{
-      if (x[i]==3)//0:sa0, 1:sa1, 2:fault free, 3:either sa0 or sa1        
-        z[i] = y[i];
-       // printf("%d\n", z[i]);
-      if (y[i]==3)
-        z[i] = x[i];
-      else 
-        z[i] = 2;
-      //printf("z:%d\n",z[i]);
-    }
-    printf("z:%d\n",z[i]);*/
-  }
-    printf("address of z = %d\n", &z);
-    return z;
-  }
-
-
-int* minus_op(int*x, int*y){
-  int i;
-  int *z;
-  z = malloc(sizeof(int)*Nnodes);
-  for(i=0; i<Nnodes; i++){
-    if (x[i]==y[i])
-      z[i] = 2;
-    else
-      z[i] = x[i];
-  }
-  /*free(x);
-  free(y);
-  free(z);*/
-  return z;////?????????????????????
-}
-
-int deductive_fault_simulation(){
+/*-----------------------------------------------------------------------
+input: optional test pattern, one 0/1 character per primary input
+output: nothing
+called by: main
+description:
+  Simulate one pattern on the fault free circuit and print the primary
+  output values, and the value of every line at verbosity 2. Primary
+  inputs not covered by the pattern are set to 0.
+-----------------------------------------------------------------------*/
+fault_free_simulation(cp)
+char *cp;
+{
+  int i, j;
+  char buf[MAXLINE], *pat;
   NSTRUC *np;
-  int i,j,k;
-  for (i = 0; i<Nnodes; i++){
-      Node[i].L = malloc(sizeof(int)*Nnodes);
-      for (j = 0; j < Nnodes; j++){
-          Node[i].L[j] = 2;  // initialize each node 's fault list
-      }
-  }
 
-  for (i = 0; i <= Maxlevel;i++){
-    for (j=0;j<Nnodes;j++){
-      np=&Node[j];
-      /*printf("node:%d type:%s level :%d\n", np->num, gname(np->type),np->level);*/
-      if(np->level == i){
-        fault_list_propogate(&Node[j]);
-      }
-    }
-  }
+  if (sscanf(cp, "%s", buf) != 1) buf[0] = '\0';
+  pat = arena_alloc(&Runarena, Npi + 1);
+  for (i = 0; i < Npi; i++) pat[i] = (i < strlen(buf) && buf[i] == '1') ? '1' : '0';
+  logic_sim(pat);
 
-  printf("%d\n",count);
-  for(i=0;i<Nnodes;i++){
-    np=&Node[i];
-    printf("node:%d type:%s level :%d\n", np->num, gname(np->type),np->level);
-    for(j=0;j<Nnodes;j++){
-      printf("%d ",Node[i].L[j]);
+  if (Verbose >= 2) {
+    for (i=0; i<Npi; i++){
+      np = Pinput[i];
+      printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, Cval[Cpi[i]]);
     }
-    printf("\n");
-    printf("\n");
+    for (j=Loffset[1]; j<Nnodes; j++){
+      np = &Node[Lorder[j]];
+      printf("node:%d, indx:%d, type:%s, level:%d,node_value:%d\n",np->num, np->indx, gname(np->type), np->level, Cval[j]);
+    }
+  }
+  for(i=0; i<Npo; i++){
+    np = Poutput[i];
+    printf("\n Node:%d indx:%d type:%s leval:%d fault_free_output: %d\n", np->num, np->indx, gname(np->type), np->level, Cval[Cpo[i]]);
   }
 
   return 1;
 }
 
-int fault_list_propogate(NSTRUC* np){
-    int i, j, m;
-    int *L1;
-    int *L2;
-
-        switch(np -> type){
-            case 0:
-                np->L[np->indx] = !(np->node_value);      
-                break;
-            case 1:
-                for(i = 0; i<Nnodes; i++){
-                    np->L[i]=np->unodes[0]->L[i]; 
-                }
-                np->L[np->indx] = !(np->node_value);
-                break;
-            case 2:
-                break;
-            case 3:
-                L1 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L1[i] = 3;
-                }
-                L2 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L2[i] = 2;
-                }
-
-                if (np->node_value==0){  
-                  for(i=0; i < np->fin; i++){
-                    L2 = union_op(L2, np->unodes[i]->L);
-                  }                                           //no input = control value
-                  np->L = L2;
-                }
-                else {
-                  for(i=0; i < np->fin; i++){
-                    if(np->unodes[i]->node_value == 1){
-                      for(m=0;m<Nnodes;m++){
-                        printf("node:%d beforeIT_1:%d\n",np->num, L1[m]);
-                      }
-                      L1 = intersaction_op(L1, np->unodes[i]->L);
-                    }
-                    else{
-                      L2 = union_op(L2, np->unodes[i]->L);
-                    }
-                    for(m=0;m<Nnodes;m++){
-                      printf("node:%d L1:%d\n",np->num, L1[m]);
-                      printf("node:%d L2:%d\n",np->num, L2[m]);     
-                    }
-                  } 
-                  np->L = minus_op(L1, L2);  
-                }
-
-                np->L[np->indx] = !(np->node_value);
-                break;   
-            case 4: 
-                L1 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L1[i] = 3;
-                }
-                L2 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L2[i] = 2;
-                }
-
-                if (np->node_value==1){  
-                  for(i=0; i < np->fin; i++){
-                    L2 = union_op(L2, np->unodes[i]->L);
-                  }                                           //no input = control value
-                  np->L = L2;
-                }
-                else {
-                  for(i=0; i < np->fin; i++){
-                    if(np->unodes[i]->node_value == 1){
-                      L1 = intersaction_op(L1, np->unodes[i]->L);
-                    }
-                    else{
-                      L2 = union_op(L2, np->unodes[i]->L);
-                    }
-                  }  
-                  np->L = minus_op(L1, L2);
-                }
-
-                np->L[np->indx] = !(np->node_value);
-                break;    
-            case 5:
-                np->L[np->indx] = !(np->node_value);
-                break;
-            case 6:                                          //NAND
-                L1 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L1[i] = 3;
-                }
-                L2 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L2[i] = 2;
-                }
-                printf("node_value:%d\n",np->node_value);
-                if (np->node_value==0){  
-                  for(i=0; i < np->fin; i++){
-                    L2 = union_op(L2, np->unodes[i]->L);
-                  }                                           //no input = control value
-                  np->L = L2;
-                }
-                else {
-                  for(i=0; i < np->fin; i++){
-                    if(np->unodes[i]->node_value == 0){
-                      L1 = intersaction_op(L1, np->unodes[i]->L);
-                      printf("address of L1 = %d\n", &L1);
-                      for(m=0;m<Nnodes;m++){
-                        printf("unodes%d L:%d\n", m, np->unodes[i]->L[m]);
-                        printf("node:%d L1:%d\n",np->num, L1[m]);  
-                    }
-                    printf("\n");
-                    }
-                    else{
-                      L2 = union_op(L2, np->unodes[i]->L);
-                      for(m=0;m<Nnodes;m++){
-                        printf("unodes%d L:%d\n", m, np->unodes[i]->L[m]);
-                        printf("node:%d L2:%d\n",np->num, L2[m]);  
-                    }
-                    }
-                    /*for(m=0;m<Nnodes;m++){
-                      printf("node:%d L1:%d\n",np->num, L1[m]);
-                      printf("node:%d L2:%d\n",np->num, L2[m]);     
-                      }*/
-                  } 
-                    for(m=0;m<Nnodes;m++){
-                      printf("finalL1 node:%d L1:%d\n",np->num, L1[m]);
-                      printf("finalL2 node:%d L2:%d\n",np->num, L2[m]);     
-                    }
-
-                  np->L = minus_op(L1, L2);
-                } 
-
-                np->L[np->indx] = !(np->node_value);
-                break;  
-            case 7:
-                L1 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L1[i] = 3;
-                }
-                L2 = malloc(sizeof(int)*Nnodes);
-                for(i = 0; i<Nnodes; i++){
-                    L2[i] = 2;
-                }
-
-                if (np->node_value==1){  
-                  for(i=0; i < np->fin; i++){
-                    L2 = union_op(L2, np->unodes[i]->L);
-                  }                                           //no input = control value
-                  np->L = L2;
-                }
-                else {
-                  for(i=0; i < np->fin; i++){
-                    if(np->unodes[i]->node_value == 0){
-                      L1 = intersaction_op(L1, np->unodes[i]->L);
-                    }
-                    else{
-                      L2 = union_op(L2, np->unodes[i]->L);
-                    }
-                  } 
-                  np->L = minus_op(L1, L2);
-                }  
-                np->L[np->indx] = !(np->node_value);
-                break;  
-        }
-        
- return 1;
+/*-----------------------------------------------------------------------
+input: pattern file, pattern buffer of Npi characters
+output: 1 if a pattern was read, 0 at end of file
+called by: psim
+description:
+  Read the next test pattern from a pattern file. A pattern is one line
+  holding a 0/1 character per primary input, in the order the inputs
+  appear in the circuit file. Blank lines and lines starting with '#'
+  are skipped, X is read as 0 and missing inputs are padded with 0.
+-----------------------------------------------------------------------*/
+int read_pattern(FILE *fd, char *pat)
+{
+  int c, n;
+
+  while ((c = getc(fd)) != EOF) {
+    if (c == '#') {
+      while ((c = getc(fd)) != EOF && c != '\n');
+      continue;
     }
-  
+    if (isspace(c)) continue;
+    n = 0;
+    do {
+      if (isspace(c)) continue;
+      if (n < Npi) pat[n++] = (c == '1') ? '1' : '0';
+    } while ((c = getc(fd)) != EOF && c != '\n');
+    while (n < Npi) pat[n++] = '0';
+    return 1;
+  }
+  return 0;
+}
 
+/*-----------------------------------------------------------------------
+input: pattern, bit position, node value array, words per node
+output: nothing
+called by: psim
+description:
+  Store a pattern as bit p of the primary input words of val[].
+-----------------------------------------------------------------------*/
+void pack_pattern(char *pat, int p, uint64_t *val, int nw)
+{
+  int i;
+  uint64_t *v;
+
+  for (i = 0; i < Npi; i++) {
+    v = &val[Cpi[i] * nw + (p >> 6)];
+    if (pat[i] == '1') *v |= 1ULL << (p & 63);
+    else *v &= ~(1ULL << (p & 63));
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: position, value array indexed by position, words per node
+output: nothing
+called by: parallel_sim
+description:
+  Evaluate one gate over nw words of packed patterns. Every bit position
+  is an independent pattern, so each fanin costs one bitwise operation
+  per word. Primary inputs keep the values stored by pack_pattern.
+-----------------------------------------------------------------------*/
+void eval_word(int p, uint64_t *val, int nw)
+{
+  uint64_t *v, *u;
+  uint32_t *in;
+  int i, w, n;
+
+  v = &val[(size_t) p * nw];
+  in = &Cfan[Cfin[p]];
+  n = Cfin[p + 1] - Cfin[p];
+  switch (Ctype[p]) {
+    case IPT:
+      break;
+    case BRCH:
+      u = &val[(size_t) in[0] * nw];
+      for (w = 0; w < nw; w++) v[w] = u[w];
+      break;
+    case XOR:
+      u = &val[(size_t) in[0] * nw];
+      for (w = 0; w < nw; w++) v[w] = u[w];
+      for (i = 1; i < n; i++) {
+        u = &val[(size_t) in[i] * nw];
+        for (w = 0; w < nw; w++) v[w] ^= u[w];
+      }
+      break;
+    case OR:
+    case NOR:
+      u = &val[(size_t) in[0] * nw];
+      for (w = 0; w < nw; w++) v[w] = u[w];
+      for (i = 1; i < n; i++) {
+        u = &val[(size_t) in[i] * nw];
+        for (w = 0; w < nw; w++) v[w] |= u[w];
+      }
+      if (Ctype[p] == NOR)
+        for (w = 0; w < nw; w++) v[w] = ~v[w];
+      break;
+    case NOT:
+      u = &val[(size_t) in[0] * nw];
+      for (w = 0; w < nw; w++) v[w] = ~u[w];
+      break;
+    case NAND:
+    case AND:
+      u = &val[(size_t) in[0] * nw];
+      for (w = 0; w < nw; w++) v[w] = u[w];
+      for (i = 1; i < n; i++) {
+        u = &val[(size_t) in[i] * nw];
+        for (w = 0; w < nw; w++) v[w] &= u[w];
+      }
+      if (Ctype[p] == NAND)
+        for (w = 0; w < nw; w++) v[w] = ~v[w];
+      break;
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: node value array, words per node
+output: nothing
+called by: psim
+description:
+  Bit-parallel fault free simulation of the packed patterns already stored
+  on the primary inputs of val[]. Positions are in level order, so the
+  sweep is a single pass over the netlist arrays.
+-----------------------------------------------------------------------*/
+void parallel_sim(uint64_t *val, int nw)
+{
+  int p;
+
+  for (p = Loffset[1]; p < Nnodes; p++) eval_word(p, val, nw);
+  Stats.evals += (uint64_t) (Nnodes - Loffset[1]) * nw;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern file name, optional response file name
+output: nothing
+called by: main
+description:
+  Bit-parallel fault free simulation. Patterns are read PBITS at a time,
+  packed one pattern per bit and simulated with parallel_sim. The primary
+  output response of every pattern is written as one line of 0/1
+  characters, to the response file if given or to stdout otherwise.
+-----------------------------------------------------------------------*/
+int psim(cp)
+char *cp;
+{
+  return sim_patterns(cp, parallel_sim, "PSIM");
+}
+
+/*-----------------------------------------------------------------------
+input: command arguments, simulation routine, command name
+output: 1 on success
+called by: psim, csim
+description:
+  The pattern loop of PSIM and CSIM: take PBITS patterns at a time from
+  the pattern stream, run sim over the value array and write the
+  responses (resp_write). Memory use does not depend on the number of
+  patterns.
+-----------------------------------------------------------------------*/
+int sim_patterns(char *cp, void (*sim)(uint64_t *, int), char *name)
+{
+  char fin[MAXLINE], fout[MAXLINE];
+  PATSTREAM ps;
+  FILE *fo;
+  uint64_t *in, total;
+  int i, p, n, bin;
+
+  n = sscanf(cp, "%s %s", fin, fout);
+  if (n < 1) {
+    printf("Usage: %s patfile [outfile]\n", name);
+    return 0;
+  }
+  if (!pat_open(&ps, fin)) return 0;
+  fo = stdout;
+  bin = 0;
+  if (n == 2 && (fo = resp_open(fout, Npo, &bin)) == NULL) {
+    pat_close(&ps);
+    return 0;
+  }
+  if (Pval == NULL) Pval = (uint64_t *) arena_alloc(&Netarena, Nnodes * PWORDS * sizeof(uint64_t));
+  total = 0;
+
+  do {
+    p = pat_next(&ps, &in);
+    for (i = 0; i < Npi; i++)
+      memcpy(&Pval[Cpi[i] * PWORDS], &in[i * PWORDS], PWORDS * sizeof(uint64_t));
+    pat_done(&ps);
+    if (p == 0) break;
+    sim(Pval, PWORDS);
+    if (sim != parallel_sim) Stats.evals += (uint64_t) (Nnodes - Loffset[1]) * PWORDS;
+    resp_write(fo, bin, Cpo, Npo, Pval, PWORDS, p);
+    total += p;
+  } while (p == PBITS);
+
+  pat_close(&ps);
+  if (fo != stdout) resp_close(fo, bin, total);
+  if (Verbose >= 1) printf("==> %llu patterns simulated\n", (unsigned long long) total);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern stream, pattern file name
+output: 1 on success, 0 if the file cannot be used
+called by: sim_patterns, ppsfp, pack, mt_simulation, batch
+description:
+  Open a pattern file for streaming. A file starting with PATMAGIC is
+  packed binary (PATHDR, then per block of 64 patterns one word per
+  primary input, bit b of the word being pattern b); anything else is
+  read as text with read_pattern. A reader thread fills two buffers of
+  PBITS patterns in turn, so parsing or reading the next block overlaps
+  the simulation of the current one. If the thread cannot be started,
+  pat_next reads each block itself.
+-----------------------------------------------------------------------*/
+int pat_open(PATSTREAM *ps, char *name)
+{
+  PATHDR h;
+
+  memset(ps, 0, sizeof(*ps));
+  if ((ps->fd = fopen(name, "rb")) == NULL) {
+    printf("File %s does not exist!\n", name);
+    return 0;
+  }
+  if (fread(&h, sizeof(h), 1, ps->fd) == 1 && !memcmp(h.magic, PATMAGIC, 8)) {
+    if (h.width != Npi) {
+      printf("%s has patterns of %u inputs, the circuit has %d!\n", name, h.width, Npi);
+      fclose(ps->fd);
+      return 0;
+    }
+    ps->binary = 1;
+    ps->left = h.npat;
+  }
+  else rewind(ps->fd);
+  setvbuf(ps->fd, NULL, _IOFBF, 1 << 20);
+  ps->pat = malloc(Npi + 1);
+  ps->buf[0] = (uint64_t *) malloc((Npi + 1) * PWORDS * sizeof(uint64_t));
+  ps->buf[1] = (uint64_t *) malloc((Npi + 1) * PWORDS * sizeof(uint64_t));
+  ps->n[0] = ps->n[1] = -1;
+  pthread_mutex_init(&ps->lock, NULL);
+  pthread_cond_init(&ps->cond, NULL);
+  ps->sync = (pthread_create(&ps->tid, NULL, pat_reader, ps) != 0);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern stream
+output: NULL
+called by: pat_open (thread)
+description:
+  Reader thread: fill the free buffers in turn until a block comes out
+  short, which marks the end of the file.
+-----------------------------------------------------------------------*/
+void *pat_reader(void *arg)
+{
+  PATSTREAM *ps = (PATSTREAM *) arg;
+  int k, n;
+
+  k = 0;
+  do {
+    pthread_mutex_lock(&ps->lock);
+    while (ps->n[k] >= 0 && !ps->stop) pthread_cond_wait(&ps->cond, &ps->lock);
+    pthread_mutex_unlock(&ps->lock);
+    if (ps->stop) break;
+    n = pat_fill(ps, ps->buf[k]);
+    pthread_mutex_lock(&ps->lock);
+    ps->n[k] = n;
+    pthread_cond_broadcast(&ps->cond);
+    pthread_mutex_unlock(&ps->lock);
+    k ^= 1;
+  } while (n == PBITS);
+  return NULL;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern stream, buffer
+output: number of patterns read into the buffer
+called by: pat_reader, pat_next
+description:
+  Read up to PBITS patterns into a buffer, bit-packed per primary input.
+  Bits past the last pattern are 0.
+-----------------------------------------------------------------------*/
+int pat_fill(PATSTREAM *ps, uint64_t *buf)
+{
+  uint64_t x;
+  int i, w, p, k;
+
+  memset(buf, 0, Npi * PWORDS * sizeof(uint64_t));
+  if (!ps->binary) {
+    for (p = 0; p < PBITS && read_pattern(ps->fd, ps->pat); p++)
+      for (i = 0; i < Npi; i++)
+        if (ps->pat[i] == '1') buf[i * PWORDS + (p >> 6)] |= 1ULL << (p & 63);
+    return p;
+  }
+  for (w = p = 0; w < PWORDS && ps->left > 0; w++) {
+    k = (ps->left < 64) ? ps->left : 64;
+    for (i = 0; i < Npi; i++) {
+      if (fread(&x, sizeof(x), 1, ps->fd) != 1) {
+        ps->left = 0;
+        return p;
+      }
+      buf[i * PWORDS + w] = (k == 64) ? x : x & ((1ULL << k) - 1);
+    }
+    ps->left -= k;
+    p += k;
+  }
+  return p;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern stream, where to return the block
+output: number of patterns in the block, PBITS except for the last one
+called by: sim_patterns, ppsfp, pack, mt_simulation, batch
+description:
+  Wait for the next filled buffer. The caller hands it back with
+  pat_done once it has copied the patterns out.
+-----------------------------------------------------------------------*/
+int pat_next(PATSTREAM *ps, uint64_t **words)
+{
+  int n;
+
+  if (ps->sync && ps->n[ps->next] < 0) ps->n[ps->next] = pat_fill(ps, ps->buf[ps->next]);
+  pthread_mutex_lock(&ps->lock);
+  while (ps->n[ps->next] < 0) pthread_cond_wait(&ps->cond, &ps->lock);
+  n = ps->n[ps->next];
+  pthread_mutex_unlock(&ps->lock);
+  *words = ps->buf[ps->next];
+  return n;
+}
+
+void pat_done(PATSTREAM *ps)
+{
+  pthread_mutex_lock(&ps->lock);
+  ps->n[ps->next] = -1;
+  ps->next ^= 1;
+  pthread_cond_broadcast(&ps->cond);
+  pthread_mutex_unlock(&ps->lock);
+}
+
+void pat_close(PATSTREAM *ps)
+{
+  pthread_mutex_lock(&ps->lock);
+  ps->stop = 1;
+  pthread_cond_broadcast(&ps->cond);
+  pthread_mutex_unlock(&ps->lock);
+  if (!ps->sync) pthread_join(ps->tid, NULL);
+  pthread_mutex_destroy(&ps->lock);
+  pthread_cond_destroy(&ps->cond);
+  fclose(ps->fd);
+  free(ps->pat);
+  free(ps->buf[0]);
+  free(ps->buf[1]);
+}
+
+/*-----------------------------------------------------------------------
+input: file name, bits per pattern, where to return the format
+output: the open file, NULL on error
+called by: sim_patterns, pack, mt_simulation, batch
+description:
+  Open a response (or pattern) output file. A name ending in ".bin"
+  gets the packed binary format, with a header whose pattern count is
+  filled in by resp_close; anything else gets one line of 0/1
+  characters per pattern.
+-----------------------------------------------------------------------*/
+FILE *resp_open(char *name, int width, int *binary)
+{
+  PATHDR h;
+  FILE *fo;
+  size_t n;
+
+  if ((fo = fopen(name, "wb")) == NULL) {
+    printf("Cannot open %s!\n", name);
+    return NULL;
+  }
+  setvbuf(fo, NULL, _IOFBF, 1 << 20);
+  n = strlen(name);
+  *binary = (n > 4 && strcmp(name + n - 4, ".bin") == 0);
+  if (*binary) {
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PATMAGIC, 8);
+    h.width = width;
+    fwrite(&h, sizeof(h), 1, fo);
+  }
+  return fo;
+}
+
+/*-----------------------------------------------------------------------
+input: output file, its format, positions of the bits to write and
+       their number, value array, words per node, number of patterns
+output: nothing
+called by: sim_patterns, pack, mt_simulation, batch
+description:
+  Write p patterns held bit-packed at the given positions of val[]:
+  one text line per pattern, or one word per position for every 64
+  patterns in the binary format.
+-----------------------------------------------------------------------*/
+void resp_write(FILE *fo, int binary, uint32_t *pos, int width, uint64_t *val, int nw, int p)
+{
+  char line[width + 2];
+  uint64_t w;
+  int i, n, k;
+
+  if (binary) {
+    for (n = 0; n < p; n += 64) {
+      k = MIN(p - n, 64);
+      for (i = 0; i < width; i++) {
+        w = val[(size_t) pos[i] * nw + (n >> 6)];
+        if (k < 64) w &= (1ULL << k) - 1;
+        fwrite(&w, sizeof(w), 1, fo);
+      }
+    }
+    return;
+  }
+  line[width] = '\n';
+  line[width + 1] = '\0';
+  for (n = 0; n < p; n++) {
+    for (i = 0; i < width; i++)
+      line[i] = '0' + ((val[(size_t) pos[i] * nw + (n >> 6)] >> (n & 63)) & 1);
+    fputs(line, fo);
+  }
+}
+
+void resp_close(FILE *fo, int binary, uint64_t npat)
+{
+  if (binary && fseek(fo, offsetof(PATHDR, npat), SEEK_SET) == 0)
+    fwrite(&npat, sizeof(npat), 1, fo);
+  fclose(fo);
+}
+
+/*-----------------------------------------------------------------------
+input: pattern file name, output file name
+output: 1 on success, 0 on error
+called by: main
+description:
+  Convert a pattern file to the packed binary format (or back to text
+  when the output name does not end in ".bin"), streaming it block by
+  block. A binary pattern file is read without any parsing and is about
+  eight times smaller than the text.
+-----------------------------------------------------------------------*/
+int pack(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE];
+  PATSTREAM ps;
+  FILE *fo;
+  uint64_t *in, total;
+  uint32_t *pos;
+  int i, p, bin;
+
+  if (sscanf(cp, "%s %s", fin, fout) != 2) {
+    printf("Usage: PACK patfile binfile\n");
+    return 0;
+  }
+  if (!pat_open(&ps, fin)) return 0;
+  if ((fo = resp_open(fout, Npi, &bin)) == NULL) {
+    pat_close(&ps);
+    return 0;
+  }
+  pos = (uint32_t *) malloc((Npi + 1) * sizeof(uint32_t));
+  for (i = 0; i < Npi; i++) pos[i] = i;
+  total = 0;
+  do {
+    p = pat_next(&ps, &in);
+    resp_write(fo, bin, pos, Npi, in, PWORDS, p);
+    pat_done(&ps);
+    total += p;
+  } while (p == PBITS);
+  pat_close(&ps);
+  resp_close(fo, bin, total);
+  free(pos);
+  if (Verbose >= 1)
+    printf("==> %llu patterns written to %s\n", (unsigned long long) total, fout);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: output file, number of gates, optional number of primary inputs,
+       gate levels, maximum fanout, reconvergence percentage and seed
+output: 1 on success, 0 on a bad argument
+called by: main
+description:
+  Synthetic benchmark generator. The gates are spread evenly over the
+  levels and each takes its first input from the level above, so the
+  circuit is as deep as asked. The other inputs come, with the
+  reconvergence probability, from the most recent signals of earlier
+  levels, so that neighbouring gates share sources and their paths
+  reconverge, and otherwise from any earlier signal. A signal feeds at
+  most fanout gates as long as other candidates are left. Signals left
+  without fanout become primary outputs and unused inputs are added to
+  random gates. The netlist is written in the self format with explicit
+  fanout branches, like the ISCAS-85 files.
+  Random reconvergence makes many faults redundant, so inputs related
+  to one already taken are avoided (gen_related) and a gate is drawn
+  again, up to GENTRY times, when random values show it constant or
+  blind to one of its inputs (gen_weak). The summary gives the share of
+  faults that random patterns leave undetected (gen_estimate), which
+  estimates the redundancy that ATPG would find.
+-----------------------------------------------------------------------*/
+int gen(cp)
+char *cp;
+{
+  char fout[MAXLINE];
+  FILE *fo;
+  int n, ngates, npi, depth, fanout, reconv, seed;
+  int i, j, k, g, s, r, l, t, nsig, navail, pbeg, pend, rr, nb, npo, nund, nsample;
+  int *type, *fin, *nfin, *nout, *avail, *apos, *brnum, *used;
+  uint64_t save, *val;
+
+  n = sscanf(cp, "%s %d %d %d %d %d %d", fout, &ngates, &npi, &depth, &fanout, &reconv, &seed);
+  if (n < 2 || ngates < 1) {
+    printf("Usage: GEN ckt_file ngates [npi [levels [fanout [reconvergence%% [seed]]]]]\n");
+    return 0;
+  }
+  if (n < 3) npi = (ngates < 80) ? 5 : ngates / 16;
+  if (n < 4) for (depth = 1; (1 << depth / 3) < ngates; depth++);
+  if (n < 5) fanout = 4;
+  if (n < 6) reconv = 50;
+  if (n < 7) seed = 1;
+  if (npi < 1 || depth < 1 || depth > ngates || fanout < 1 || reconv < 0 || reconv > 100) {
+    printf("Usage: GEN ckt_file ngates [npi [levels [fanout [reconvergence%% [seed]]]]]\n");
+    return 0;
+  }
+  if ((fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    return 0;
+  }
+  setvbuf(fo, NULL, _IOFBF, 1 << 20);
+  save = Xstate;
+  Xstate = XSEED ^ ((uint64_t) seed * 0x9e3779b97f4a7c15ULL);
+  if (Xstate == 0) Xstate = 1;
+
+  nsig = npi + ngates;                 /* signal s < npi: input, else gate s - npi */
+  type = (int *) malloc(ngates * sizeof(int));
+  fin = (int *) malloc(4 * (size_t) ngates * sizeof(int));
+  nfin = (int *) malloc(ngates * sizeof(int));
+  nout = (int *) calloc(nsig, sizeof(int));
+  avail = (int *) malloc(nsig * sizeof(int));
+  apos = (int *) malloc(nsig * sizeof(int));
+  val = (uint64_t *) malloc((size_t) nsig * GENWORDS * sizeof(uint64_t));
+  for (s = 0; s < npi; s++) {
+    avail[s] = s;
+    apos[s] = s;
+    for (i = 0; i < GENWORDS; i++) val[(size_t) s * GENWORDS + i] = xrand();
+  }
+  navail = npi;
+  pbeg = 0;
+  pend = npi;
+  rr = 0;
+  l = 1;
+  for (g = 0; g < ngates; g++) {
+    s = npi + g;
+    if (1 + (int) ((int64_t) g * depth / ngates) > l) {   /* next level */
+      for (i = pend; i < s; i++) {
+        apos[i] = navail;
+        avail[navail++] = i;
+      }
+      pbeg = pend;
+      pend = s;
+      rr = 0;
+      l++;
+    }
+    r = xrand() % 20;
+    type[g] = (r == 0) ? NOT : (r <= 3) ? XOR :
+              (r % 4 == 0) ? AND : (r % 4 == 1) ? NAND : (r % 4 == 2) ? OR : NOR;
+    k = (type[g] == NOT) ? 1 : (type[g] == XOR || xrand() % 4) ? 2 : 3;
+    fin[4 * g] = pbeg + rr++ % (pend - pbeg);
+    for (t = 0; t < GENTRY; t++) {
+      nfin[g] = 1;
+      for (j = 1; j < k; j++) {
+        for (i = 0; i < 8; i++) {        /* a few tries to avoid a related input */
+          if (navail == 0) r = xrand() % pend;
+          else if ((int) (xrand() % 100) < reconv)
+            r = avail[navail - 1 - xrand() % MIN(navail, 64)];
+          else r = avail[xrand() % navail];
+          for (n = 0; n < nfin[g] && !gen_related(npi, fin, nfin, fin[4 * g + n], r); n++);
+          if (n == nfin[g]) break;
+        }
+        if (i < 8) fin[4 * g + nfin[g]++] = r;
+      }
+      if (!gen_weak(type[g], &fin[4 * g], nfin[g], val, &val[(size_t) s * GENWORDS])) break;
+    }
+    for (j = 0; j < nfin[g]; j++) {
+      r = fin[4 * g + j];
+      if (++nout[r] == fanout && apos[r] >= 0) {
+        avail[apos[r]] = avail[--navail];    /* full: no longer a candidate */
+        apos[avail[apos[r]]] = apos[r];
+        apos[r] = -1;
+      }
+    }
+  }
+
+  /* inputs nobody reads go to random gates with a free input slot */
+  for (s = 0; s < npi; s++)
+    for (i = 0; nout[s] == 0 && i < 64; i++) {
+      g = xrand() % ngates;
+      if (type[g] == NOT || nfin[g] == 4) continue;
+      fin[4 * g + nfin[g]++] = s;
+      nout[s] = 1;
+    }
+
+  /* fanout branches are numbered after the stems */
+  brnum = (int *) malloc(nsig * sizeof(int));
+  used = (int *) calloc(nsig, sizeof(int));
+  for (s = 0, nb = nsig + 1; s < nsig; s++) {
+    brnum[s] = nb;
+    if (nout[s] > 1) nb += nout[s];
+  }
+  for (s = npo = 0; s < nsig; s++) {
+    if (s < npi) fprintf(fo, "%d %d %d %d 0", PI, s + 1, IPT, nout[s]);
+    else {
+      g = s - npi;
+      npo += (nout[s] == 0);
+      fprintf(fo, "%d %d %d %d %d", nout[s] ? GATE : PO, s + 1, type[g], nout[s], nfin[g]);
+      for (j = 0; j < nfin[g]; j++) {
+        r = fin[4 * g + j];
+        fprintf(fo, " %d", (nout[r] > 1) ? brnum[r] + used[r]++ : r + 1);
+      }
+    }
+    fprintf(fo, "\n");
+    if (nout[s] > 1)
+      for (j = 0; j < nout[s]; j++) fprintf(fo, "%d %d %d %d\n", FB, brnum[s] + j, BRCH, s + 1);
+  }
+  fclose(fo);
+  nund = gen_estimate(npi, ngates, type, fin, nfin, nout, val, &nsample);
+  if (Verbose >= 1) {
+    printf("==> %d gates, %d inputs, %d outputs, %d branches, %d levels written to %s\n",
+           ngates, npi, npo, nb - nsig - 1, depth, fout);
+    printf("    %.1f%% redundant or random resistant faults: %d of %d sampled escape %d random patterns\n",
+           nsample ? 100.0 * nund / nsample : 0.0, nund, nsample, 64 * GENWORDS * GENPASS);
+  }
+  Xstate = save;
+  free(type);
+  free(fin);
+  free(nfin);
+  free(nout);
+  free(avail);
+  free(apos);
+  free(brnum);
+  free(used);
+  free(val);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: number of primary inputs, fanins and fanin counts of the gates,
+       two signals
+output: 1 if the signals are the same, one feeds the other or both
+        share a fanin, 0 otherwise
+called by: gen
+description:
+  A gate whose inputs are this close reconverges right away, as in
+  AND(a, OR(a, b)), and usually leaves one of them without effect.
+-----------------------------------------------------------------------*/
+int gen_related(int npi, int *fin, int *nfin, int a, int b)
+{
+  int i, j, na, nb;
+
+  if (a == b) return 1;
+  na = (a < npi) ? 0 : nfin[a - npi];
+  nb = (b < npi) ? 0 : nfin[b - npi];
+  for (i = 0; i < na; i++)
+    if (fin[4 * (a - npi) + i] == b) return 1;
+  for (j = 0; j < nb; j++)
+    if (fin[4 * (b - npi) + j] == a) return 1;
+  for (i = 0; i < na; i++)
+    for (j = 0; j < nb; j++)
+      if (fin[4 * (a - npi) + i] == fin[4 * (b - npi) + j]) return 1;
+  return 0;
+}
+
+/*-----------------------------------------------------------------------
+input: gate type, input words, number of inputs
+output: output word of the gate
+called by: gen_weak, gen_estimate
+description:
+  One word of a GEN gate, 64 patterns at once.
+-----------------------------------------------------------------------*/
+uint64_t gen_op(int type, uint64_t *u, int n)
+{
+  uint64_t v;
+  int i;
+
+  v = (type == AND || type == NAND) ? ~0ULL : 0;
+  for (i = 0; i < n; i++) {
+    if (type == AND || type == NAND) v &= u[i];
+    else if (type == XOR) v ^= u[i];
+    else v |= u[i];
+  }
+  return (type == NOT || type == NAND || type == NOR) ? ~v : v;
+}
+
+/*-----------------------------------------------------------------------
+input: gate type, its input signals and their number, random values of
+       the signals (GENWORDS words each), output words of the gate
+output: 1 if the gate is constant or one input never changes its
+        output on these values, 0 otherwise
+called by: gen
+description:
+  Checks a gate drawn by GEN against the random values of its inputs
+  and stores its output words. Either outcome makes faults around the
+  gate redundant, or at least hard, so GEN draws the inputs again.
+-----------------------------------------------------------------------*/
+int gen_weak(int type, int *in, int n, uint64_t *val, uint64_t *out)
+{
+  uint64_t u[4], one, d;
+  int i, j, w;
+
+  for (w = 0, d = 0; w < GENWORDS; w++) {
+    for (j = 0; j < n; j++) u[j] = val[(size_t) in[j] * GENWORDS + w];
+    out[w] = gen_op(type, u, n);
+    one = (out[0] & 1) ? ~0ULL : 0;
+    d |= out[w] ^ one;
+  }
+  if (d == 0) return 1;                  /* constant */
+  for (i = 0; i < n; i++) {
+    for (w = 0, d = 0; w < GENWORDS; w++) {
+      for (j = 0; j < n; j++) u[j] = val[(size_t) in[j] * GENWORDS + w];
+      u[i] = ~u[i];
+      d |= gen_op(type, u, n) ^ out[w];
+    }
+    if (d == 0) return 1;                /* input i never matters */
+  }
+  return 0;
+}
+
+/*-----------------------------------------------------------------------
+input: the netlist of GEN (number of inputs and gates, gate types,
+       fanins, fanin and fanout counts), value buffer of GENWORDS words
+       per signal, sample size to return
+output: number of sampled faults that no random pattern detects
+called by: gen
+description:
+  Redundancy estimate of a generated circuit. The faults are the
+  stuck-at faults of every signal and of every fanout branch, and up
+  to GENSAMPLE of them are drawn. Each of the GENPASS passes simulates
+  64 * GENWORDS new random patterns and propagates every fault still
+  undetected through the gates its difference reaches, in gate order,
+  until an output sees it. The faults left are redundant or resist
+  random patterns; the second kind makes the estimate high for large
+  circuits.
+-----------------------------------------------------------------------*/
+int gen_estimate(int npi, int ngates, int *type, int *fin, int *nfin, int *nout,
+                 uint64_t *val, int *nsample)
+{
+  uint64_t u[4], *fv, d;
+  int *fo, *fout, *pin, *stamp, *pend, *smp;
+  int i, j, g, h, s, n, w, x, f, m, nf, npin, nsig, npend, nund, det, pass;
+
+  /* fanout lists of the signals and the branch pins */
+  nsig = npi + ngates;
+  fo = (int *) calloc(nsig + 1, sizeof(int));
+  for (g = 0; g < ngates; g++)
+    for (j = 0; j < nfin[g]; j++) fo[fin[4 * g + j] + 1]++;
+  for (s = 0; s < nsig; s++) fo[s + 1] += fo[s];
+  fout = (int *) malloc((fo[nsig] + 1) * sizeof(int));
+  pin = (int *) malloc((fo[nsig] + 1) * sizeof(int));
+  for (g = npin = 0; g < ngates; g++)
+    for (j = 0; j < nfin[g]; j++) {
+      s = fin[4 * g + j];
+      fout[fo[s]++] = g;
+      if (nout[s] > 1) pin[npin++] = 4 * g + j;
+    }
+  for (s = nsig; s > 0; s--) fo[s] = fo[s - 1];
+  fo[0] = 0;
+
+  nf = 2 * (nsig + npin);
+  m = MIN(nf, GENSAMPLE);
+  smp = (int *) malloc(m * sizeof(int));
+  for (x = 0; x < m; x++) smp[x] = (m == nf) ? x : (int) (xrand() % nf);
+  fv = (uint64_t *) malloc((size_t) nsig * GENWORDS * sizeof(uint64_t));
+  stamp = (int *) calloc(nsig, sizeof(int));
+  pend = (int *) calloc(ngates, sizeof(int));
+  nund = m;
+  for (pass = 0; pass < GENPASS && nund > 0; pass++) {
+    for (s = 0; s < npi; s++)
+      for (w = 0; w < GENWORDS; w++) val[(size_t) s * GENWORDS + w] = xrand();
+    for (g = 0; g < ngates; g++) {
+      s = npi + g;
+      for (w = 0; w < GENWORDS; w++) {
+        for (j = 0; j < nfin[g]; j++) u[j] = val[(size_t) fin[4 * g + j] * GENWORDS + w];
+        val[(size_t) s * GENWORDS + w] = gen_op(type[g], u, nfin[g]);
+      }
+    }
+    memset(stamp, 0, nsig * sizeof(int));
+    memset(pend, 0, ngates * sizeof(int));
+    for (x = n = 0; x < nund; x++) {
+      f = smp[x];
+      if (f < 2 * nsig) {                /* stuck-at on signal s */
+        s = f / 2;
+        for (w = 0; w < GENWORDS; w++) fv[(size_t) s * GENWORDS + w] = (f & 1) ? ~0ULL : 0;
+      } else {                           /* stuck-at on input j of gate g */
+        g = pin[(f - 2 * nsig) / 2] / 4;
+        j = pin[(f - 2 * nsig) / 2] % 4;
+        s = npi + g;
+        for (w = 0; w < GENWORDS; w++) {
+          for (i = 0; i < nfin[g]; i++) u[i] = val[(size_t) fin[4 * g + i] * GENWORDS + w];
+          u[j] = (f & 1) ? ~0ULL : 0;
+          fv[(size_t) s * GENWORDS + w] = gen_op(type[g], u, nfin[g]);
+        }
+      }
+      for (w = 0, d = 0; w < GENWORDS; w++)
+        d |= fv[(size_t) s * GENWORDS + w] ^ val[(size_t) s * GENWORDS + w];
+      g = (s < npi) ? 0 : s - npi + 1;
+      for (det = npend = 0; ; g++) {
+        if (d && s >= npi && nout[s] == 0) det = 1;   /* at an output */
+        else if (d) {
+          stamp[s] = x + 1;
+          for (i = fo[s]; i < fo[s + 1]; i++)
+            if (pend[fout[i]] != x + 1) {
+              pend[fout[i]] = x + 1;
+              npend++;
+            }
+        }
+        if (det || npend == 0) break;
+        while (pend[g] != x + 1) g++;
+        npend--;
+        s = npi + g;
+        for (w = 0, d = 0; w < GENWORDS; w++) {
+          for (i = 0; i < nfin[g]; i++) {
+            h = fin[4 * g + i];
+            u[i] = (stamp[h] == x + 1) ? fv[(size_t) h * GENWORDS + w] : val[(size_t) h * GENWORDS + w];
+          }
+          fv[(size_t) s * GENWORDS + w] = gen_op(type[g], u, nfin[g]);
+          d |= fv[(size_t) s * GENWORDS + w] ^ val[(size_t) s * GENWORDS + w];
+        }
+      }
+      if (!det) smp[n++] = f;             /* keep it for the next pass */
+    }
+    nund = n;
+  }
+  free(fo);
+  free(fout);
+  free(pin);
+  free(smp);
+  free(fv);
+  free(stamp);
+  free(pend);
+  *nsample = m;
+  return nund;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: seconds of the monotonic clock
+called by: main, bench
+description:
+  Wall clock for the phase timings.
+-----------------------------------------------------------------------*/
+double wall_clock()
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: CPU seconds used by the process, all threads together
+called by: main
+description:
+  CPU clock of the STATS phase timers.
+-----------------------------------------------------------------------*/
+double cpu_clock()
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: peak resident set size of the process in KB
+called by: bench, stats
+description:
+  High-water mark of the memory use, from getrusage.
+-----------------------------------------------------------------------*/
+long peak_rss()
+{
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern file name, number of patterns
+output: 1 on success, 0 if the file cannot be written
+called by: bench
+description:
+  Write random patterns for the benchmark, always the same ones for a
+  given number of inputs. The random state of the session is restored.
+-----------------------------------------------------------------------*/
+int bench_patterns(char *name, int npat)
+{
+  FILE *fd;
+  char *line;
+  int i, k;
+  uint64_t save;
+
+  if ((fd = fopen(name, "w")) == NULL) {
+    printf("Cannot open %s!\n", name);
+    return 0;
+  }
+  line = malloc(Npi + 1);
+  save = Xstate;
+  Xstate = XSEED;
+  for (k = 0; k < npat; k++) {
+    for (i = 0; i < Npi; i++) line[i] = '0' + (xrand() >> 32 & 1);
+    line[Npi] = '\n';
+    fwrite(line, 1, Npi + 1, fd);
+  }
+  fclose(fd);
+  free(line);
+  Xstate = save;
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: circuit file, optional number of random patterns, JSON file and
+       list of engines (psim csim pfs dfs bdfs cfs ppsfp mtfs atpg)
+output: 1 on success, 0 if the circuit cannot be read
+called by: main
+description:
+  Benchmark of one circuit. It times the parse (with the compiled
+  netlist cache of the circuit moved aside, and put back at the end),
+  levelization, the cached load and fault collapsing, then each engine
+  on the same random patterns, and prints the seconds, patterns/s,
+  faults x patterns/s and the peak RSS so far. The fault
+  count of an engine is its fault universe, so for the engines that
+  drop faults the rate is over the nominal work. With a JSON file the
+  run is appended to it as one JSON object per line, for tracking
+  regressions across versions. The commands run at verbosity 0, each
+  with the run arena reset as main does for a command; the verbosity
+  and the random state of the session are restored afterwards.
+-----------------------------------------------------------------------*/
+int bench(cp)
+char *cp;
+{
+  static char *pname[BENCHPHASES] = {"cread", "lev", "cread_cache", "gfl", "psim", "csim",
+    "pfs", "dfs", "bdfs", "cfs", "ppsfp", "mtfs", "atpg"};
+  static int (*pfn[BENCHPHASES])() = {cread, lev, cread, preprocessor, psim, csim, pfs,
+    deductive_fault_simulation, bitset_dfs, concurrent_fault_simulation, ppsfp,
+    mt_fault_simulation, atpg};
+  char ckt[MAXLINE], json[MAXLINE], pat[MAXLINE], arg[3 * MAXLINE], tok[MAXLINE];
+  char fsc[MAXLINE + 4], keep[MAXLINE + 16], run[BENCHPHASES];
+  double sec[BENCHPHASES], work[BENCHPHASES], t;
+  long rss[BENCHPHASES];
+  int i, k, n, npat, nth, nf, sv, ok, kept;
+  uint64_t save;
+  FILE *fd;
+
+  json[0] = '\0';
+  npat = 1024;
+  memset(run, 0, sizeof(run));
+  if (sscanf(cp, "%s%n", ckt, &n) != 1) {
+    printf("Usage: BENCH ckt_file [npatterns] [jsonfile] [engine ...]\n");
+    return 0;
+  }
+  for (cp += n, k = 0; sscanf(cp, "%s%n", tok, &n) == 1; cp += n, k++) {
+    for (i = 4; i < BENCHPHASES && strcasecmp(tok, pname[i]); i++);
+    if (i < BENCHPHASES) run[i] = 1;
+    else if (k == 0 && isdigit((unsigned char) tok[0])) npat = atoi(tok);
+    else if (json[0] == '\0') strcpy(json, tok);
+    else {
+      printf("Usage: BENCH ckt_file [npatterns] [jsonfile] [engine ...]\n");
+      return 0;
+    }
+  }
+  for (i = 4; i < BENCHPHASES && !run[i]; i++);
+  memset(run, 1, (i == BENCHPHASES) ? BENCHPHASES : 4);
+  if (strlen(ckt) + strlen(".bench.pat") >= MAXLINE) {
+    printf("File name %s is too long!\n", ckt);
+    return 0;
+  }
+  if ((nth = sysconf(_SC_NPROCESSORS_ONLN)) < 1) nth = 1;
+  sprintf(pat, "%s.bench.pat", ckt);
+  sprintf(fsc, "%s.fsc", ckt);         /* time the parse: move the cache aside */
+  sprintf(keep, "%s.bench", fsc);
+  kept = (access(fsc, F_OK) == 0);
+  if (kept && rename(fsc, keep) != 0) {
+    printf("Cannot move %s aside!\n", fsc);
+    return 0;
+  }
+
+  sv = Verbose;
+  Verbose = 0;
+  save = Xstate;
+  nf = 0;
+  for (i = 0; i < BENCHPHASES; i++) {
+    if (i == 4) {
+      nf = build_target_faults();
+      if (!bench_patterns(pat, npat)) break;
+    }
+    sec[i] = -1;
+    if (!run[i]) continue;
+    if (i == 0 || i == 2) strcpy(arg, ckt);
+    else if (i < 4) arg[0] = '\0';
+    else if (i == 11) sprintf(arg, "%d %s /dev/null", nth, pat);
+    else if (i == 12) strcpy(arg, "/dev/null");
+    else sprintf(arg, "%s /dev/null", pat);
+    Xstate = XSEED;
+    arena_reset(&Runarena);
+    t = wall_clock();
+    ok = (*pfn[i])(arg);
+    t = wall_clock() - t;
+    if (!ok) {
+      printf("%s failed\n", pname[i]);
+      if (i < 4) break;
+      continue;
+    }
+    sec[i] = t;
+    rss[i] = peak_rss();
+    work[i] = (i < 6) ? 0 : (i == 7 || i == 8) ? 2.0 * Nnodes : (i == 12) ? -1 : nf;
+  }
+  unlink(pat);
+  if (kept) rename(keep, fsc);         /* the user's cache, as it was */
+  Verbose = sv;
+  Xstate = save;
+  if (i < BENCHPHASES) return 0;
+
+  printf("%s: %d nodes, %d PIs, %d POs, %d levels, %d faults, %d patterns, %d threads\n",
+         ckt, Nnodes, Npi, Npo, Maxlevel, nf, npat, nth);
+  printf("%-12s %10s %12s %18s %10s\n", "phase", "seconds", "patterns/s",
+         "faults*patterns/s", "peak KB");
+  for (i = 0; i < BENCHPHASES; i++) {
+    if (sec[i] < 0) continue;
+    printf("%-12s %10.4f", pname[i], sec[i]);
+    if (i < 4) printf(" %12s %18s %10ld\n", "-", "-", rss[i]);
+    else if (work[i] < 0) printf(" %12s %18s %10ld  %d tests\n", "-", "-", rss[i], Ntset);
+    else if (work[i] == 0) printf(" %12.0f %18s %10ld\n", npat / sec[i], "-", rss[i]);
+    else printf(" %12.0f %18.4g %10ld\n", npat / sec[i], work[i] * npat / sec[i], rss[i]);
+  }
+  if (json[0] == '\0') return 1;
+
+  if ((fd = fopen(json, "a")) == NULL) {
+    printf("Cannot open %s!\n", json);
+    return 0;
+  }
+  fprintf(fd, "{\"circuit\": \"%s\", \"time\": %lld, \"pwords\": %d, \"threads\": %d, "
+          "\"nodes\": %d, \"pi\": %d, \"po\": %d, \"levels\": %d, \"faults\": %d, "
+          "\"patterns\": %d, \"phases\": [", ckt, (long long) time(NULL), PWORDS, nth,
+          Nnodes, Npi, Npo, Maxlevel, nf, npat);
+  for (i = k = 0; i < BENCHPHASES; i++) {
+    if (sec[i] < 0) continue;
+    fprintf(fd, "%s{\"name\": \"%s\", \"seconds\": %.6f, \"peak_rss_kb\": %ld", k++ ? ", " : "",
+            pname[i], sec[i], rss[i]);
+    if (i >= 4 && work[i] >= 0) fprintf(fd, ", \"patterns_per_sec\": %.1f", npat / sec[i]);
+    if (work[i] > 0) fprintf(fd, ", \"fault_patterns_per_sec\": %.1f", work[i] * npat / sec[i]);
+    if (work[i] < 0) fprintf(fd, ", \"tests\": %d, \"faults_per_sec\": %.1f", Ntset, nf / sec[i]);
+    fprintf(fd, "}");
+  }
+  fprintf(fd, "]}\n");
+  fclose(fd);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: faults dropped by a block of patterns
+output: nothing
+called by: drop_detected, random_phase, tset_sim, atpg
+description:
+  Count one pattern block of a fault dropping loop for STATS.
+-----------------------------------------------------------------------*/
+void stats_drop(int n)
+{
+  Stats.blocks++;
+  Stats.dropped += n;
+  if (n > Stats.maxdrop) Stats.maxdrop = n;
+}
+
+/*-----------------------------------------------------------------------
+input: optional "reset" or JSON file name
+output: 1 on success, 0 if the file cannot be written
+called by: main
+description:
+  Report the phase timers and hot-path counters gathered since the
+  start or the last STATS reset: wall and CPU seconds of parsing (READ),
+  levelization (LEV), collapsing (GFL), simulation (the simulation
+  commands) and ATPG (ATPG, COMPACT), then gate evaluations, events of
+  the event-driven engines, faults dropped per pattern block, PODEM
+  backtracks per target, arena bytes, the memory held by the netlist,
+  run and pattern arenas with the most each had in use, and the
+  deductive fault list sizes per level (listed at verbosity 2). A
+  session whose peaks stay put across repeated commands does not leak.
+  With a file name the same report is
+  written there as JSON. The counters are plain increments made by the
+  main thread; worker threads count in their own PPSTRUC, which is
+  added in when it is freed, so no counter is shared between threads.
+-----------------------------------------------------------------------*/
+int stats(cp)
+char *cp;
+{
+  static char *phname[PH_NONE] = {"parse", "levelize", "collapse", "simulate", "atpg"};
+  char arg[MAXLINE];
+  FILE *fd;
+  int i, l, lmean;
+  uint64_t nl, nent, flmax;
+
+  if (sscanf(cp, "%s", arg) != 1) arg[0] = '\0';
+  if (strcasecmp(arg, "reset") == 0) {
+    free(Stats.flsum);
+    free(Stats.flcnt);
+    free(Stats.flmax);
+    memset(&Stats, 0, sizeof(STATS));
+    Netarena.peak = Netarena.inuse;
+    Runarena.peak = Runarena.inuse;
+    Patarena.peak = Patarena.inuse;
+    return 1;
+  }
+  nl = nent = flmax = 0;
+  lmean = -1;
+  for (l = 0; l < Stats.nlev; l++) {
+    nl += Stats.flcnt[l];
+    nent += Stats.flsum[l];
+    if (Stats.flmax[l] > flmax) flmax = Stats.flmax[l];
+    if (Stats.flcnt[l] && (lmean < 0 || Stats.flsum[l] * Stats.flcnt[lmean] >
+                                        Stats.flsum[lmean] * Stats.flcnt[l])) lmean = l;
+  }
+
+  printf("==> phase      calls    wall s     cpu s\n");
+  for (i = 0; i < PH_NONE; i++)
+    printf("    %-9s %6d %9.3f %9.3f\n", phname[i], Stats.calls[i], Stats.wall[i], Stats.cpu[i]);
+  printf("    %llu gate evaluations, %llu events, peak RSS %ld KB\n",
+         (unsigned long long) Stats.evals, (unsigned long long) Stats.events, peak_rss());
+  printf("    fault dropping: %llu faults in %llu blocks, %.1f per block, at most %llu\n",
+         (unsigned long long) Stats.dropped, (unsigned long long) Stats.blocks,
+         Stats.blocks ? (double) Stats.dropped / Stats.blocks : 0.0,
+         (unsigned long long) Stats.maxdrop);
+  printf("    PODEM: %llu targets, %llu backtracks, %.2f per target, at most %llu\n",
+         (unsigned long long) Stats.targets, (unsigned long long) Stats.backtracks,
+         Stats.targets ? (double) Stats.backtracks / Stats.targets : 0.0,
+         (unsigned long long) Stats.maxbt);
+  if (Stats.targets) {
+    printf("    targets by backtracks:");
+    for (i = 0; i < BTBUCKETS; i++) {
+      if (Stats.bthist[i] == 0) continue;
+      if (i < 2) printf(" %d:", i);
+      else if (i == BTBUCKETS - 1) printf(" %d+:", 1 << (i - 1));
+      else printf(" %d-%d:", 1 << (i - 1), (1 << i) - 1);
+      printf("%llu", (unsigned long long) Stats.bthist[i]);
+    }
+    printf("\n");
+  }
+  printf("    arenas: %llu bytes allocated, %llu bytes of blocks\n",
+         (unsigned long long) Stats.abytes, (unsigned long long) Stats.ablocks);
+  printf("    arena KB held/peak in use: netlist %zu/%zu, run %zu/%zu, pattern %zu/%zu\n",
+         arena_size(&Netarena) >> 10, Netarena.peak >> 10, arena_size(&Runarena) >> 10,
+         Runarena.peak >> 10, arena_size(&Patarena) >> 10, Patarena.peak >> 10);
+  if (nl) {
+    printf("    deductive fault lists: %llu built, mean %.1f, largest %llu,"
+           " largest mean %.1f at level %d\n", (unsigned long long) nl, (double) nent / nl, (unsigned long long) flmax,
+           (double) Stats.flsum[lmean] / Stats.flcnt[lmean], lmean);
+    for (l = 0; Verbose >= 2 && l < Stats.nlev; l++)
+      if (Stats.flcnt[l])
+        printf("      level %d: %llu lists, mean %.1f, largest %llu\n", l,
+               (unsigned long long) Stats.flcnt[l], (double) Stats.flsum[l] / Stats.flcnt[l],
+               (unsigned long long) Stats.flmax[l]);
+  }
+  if (arg[0] == '\0') return 1;
+
+  if ((fd = fopen(arg, "w")) == NULL) {
+    printf("Cannot open %s!\n", arg);
+    return 0;
+  }
+  fprintf(fd, "{\n  \"phases\": {");
+  for (i = 0; i < PH_NONE; i++)
+    fprintf(fd, "%s\n    \"%s\": {\"calls\": %d, \"wall\": %.6f, \"cpu\": %.6f}", i ? "," : "",
+            phname[i], Stats.calls[i], Stats.wall[i], Stats.cpu[i]);
+  fprintf(fd, "\n  },\n");
+  fprintf(fd, "  \"gate_evaluations\": %llu,\n  \"events\": %llu,\n  \"peak_rss_kb\": %ld,\n",
+          (unsigned long long) Stats.evals, (unsigned long long) Stats.events, peak_rss());
+  fprintf(fd, "  \"drop_blocks\": %llu,\n  \"faults_dropped\": %llu,\n"
+          "  \"max_dropped_per_block\": %llu,\n",
+          (unsigned long long) Stats.blocks, (unsigned long long) Stats.dropped,
+          (unsigned long long) Stats.maxdrop);
+  fprintf(fd, "  \"atpg_targets\": %llu,\n  \"backtracks\": %llu,\n  \"max_backtracks\": %llu,\n",
+          (unsigned long long) Stats.targets, (unsigned long long) Stats.backtracks,
+          (unsigned long long) Stats.maxbt);
+  fprintf(fd, "  \"backtrack_histogram_log2\": [");
+  for (i = 0; i < BTBUCKETS; i++)
+    fprintf(fd, "%s%llu", i ? ", " : "", (unsigned long long) Stats.bthist[i]);
+  fprintf(fd, "],\n  \"arena_bytes\": %llu,\n  \"arena_block_bytes\": %llu,\n",
+          (unsigned long long) Stats.abytes, (unsigned long long) Stats.ablocks);
+  fprintf(fd, "  \"arenas\": {\"netlist\": {\"held\": %zu, \"peak\": %zu}, "
+          "\"run\": {\"held\": %zu, \"peak\": %zu}, \"pattern\": {\"held\": %zu, \"peak\": %zu}},\n",
+          arena_size(&Netarena), Netarena.peak, arena_size(&Runarena), Runarena.peak,
+          arena_size(&Patarena), Patarena.peak);
+  fprintf(fd, "  \"fault_lists_by_level\": [");
+  for (l = 0; l < Stats.nlev; l++)
+    fprintf(fd, "%s\n    {\"level\": %d, \"lists\": %llu, \"entries\": %llu, \"max\": %llu}",
+            l ? "," : "", l, (unsigned long long) Stats.flcnt[l],
+            (unsigned long long) Stats.flsum[l], (unsigned long long) Stats.flmax[l]);
+  fprintf(fd, "%s]\n}\n", Stats.nlev ? "\n  " : "");
+  fclose(fd);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: circuit file, pattern file, response file, optional detection
+       report file
+output: exit status of the program
+called by: main
+description:
+  Batch mode, for runs too large for the interactive flow. The circuit
+  is read and levelized (or loaded from its cache) and the patterns are
+  streamed through bit-parallel simulation PBITS at a time, double
+  buffered by the reader thread. The primary output responses are
+  written as they are computed, as text or packed binary (".bin"). With
+  a detection file, the collapsed fault list is also fault simulated
+  with PPSFP and fault dropping, one "pattern N: faults" record per
+  pattern. Memory use is fixed by the circuit, not by the pattern count.
+-----------------------------------------------------------------------*/
+int batch(int argc, char **argv)
+{
+  char cmd[MAXLINE];
+  PATSTREAM ps;
+  PPSTRUC w;
+  FILE *fo, *fd;
+  uint64_t *in, *good, valid, det, total;
+  int i, k, p, n, np, bin, nlive, ndet, *live, *detp;
+
+  if (argc < 3 || argc > 4) {
+    fprintf(stderr, "Usage: fsim [circuit patfile respfile [detfile]]\n");
+    return 2;
+  }
+  Verbose = 0;                        /* stdout may be a response file */
+  if (strlen(argv[0]) >= MAXLINE) {
+    fprintf(stderr, "File name %s is too long!\n", argv[0]);
+    return 1;
+  }
+  snprintf(cmd, MAXLINE, "%s", argv[0]);
+  if (!cread(cmd)) return 1;
+  if (Gstate < CKTLEV && !lev()) return 1;
+  fd = NULL;
+  if (argc == 4) {
+    preprocessor("");
+    if (build_target_faults() < 0) return 1;
+    if ((fd = fopen(argv[3], "w")) == NULL) {
+      fprintf(stderr, "Cannot open %s!\n", argv[3]);
+      return 1;
+    }
+    setvbuf(fd, NULL, _IOFBF, 1 << 20);
+  }
+  if (!pat_open(&ps, argv[1])) return 1;
+  if ((fo = resp_open(argv[2], Npo, &bin)) == NULL) return 1;
+  if (Pval == NULL) Pval = (uint64_t *) arena_alloc(&Netarena, Nnodes * PWORDS * sizeof(uint64_t));
+  if (fd != NULL) {
+    ppsfp_init(&w);
+    good = (uint64_t *) arena_alloc(&Runarena, Nnodes * sizeof(uint64_t));
+    live = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+    detp = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+    memcpy(live, Flist, Nflist * sizeof(int));
+  }
+  nlive = Nflist;
+  total = ndet = 0;
+
+  do {
+    np = pat_next(&ps, &in);
+    for (i = 0; i < Npi; i++)
+      memcpy(&Pval[Cpi[i] * PWORDS], &in[i * PWORDS], PWORDS * sizeof(uint64_t));
+    pat_done(&ps);
+    if (np == 0) break;
+    parallel_sim(Pval, PWORDS);
+    resp_write(fo, bin, Cpo, Npo, Pval, PWORDS, np);
+    for (k = 0; fd != NULL && k < np; k += 64) {
+      p = MIN(np - k, 64);
+      for (i = 0; i < Nnodes; i++) good[i] = Pval[i * PWORDS + (k >> 6)];
+      valid = (p == 64) ? ~0ULL : (1ULL << p) - 1;
+      for (i = 0; i < nlive; i++) {
+        det = ppsfp_fault(&w, live[i], good, valid, 0);
+        detp[i] = det ? __builtin_ctzll(det) : -1;
+      }
+      n = drop_detected(live, nlive, detp, total + k, p, fd);
+      nlive -= n;
+      ndet += n;
+    }
+    total += np;
+  } while (np == PBITS);
+
+  pat_close(&ps);
+  resp_close(fo, bin, total);
+  fprintf(stderr, "==> %llu patterns simulated", (unsigned long long) total);
+  if (fd != NULL) {
+    fclose(fd);
+    fprintf(stderr, ", %d of %d faults detected (%.2f%%)", ndet, Nflist,
+            Nflist ? 100.0 * ndet / Nflist : 0.0);
+    ppsfp_free(&w);
+  }
+  fprintf(stderr, "\n");
+  return 0;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern, one 0/1 character per primary input
+output: nothing
+called by: fault_free_simulation, deductive_fault_simulation, bitset_dfs
+description:
+  Quiet fault free simulation of one pattern. The pattern is run through
+  the bit-parallel engine in bit 0 and copied into Cval.
+-----------------------------------------------------------------------*/
+void logic_sim(char *pat)
+{
+  int i;
+
+  if (Pval == NULL) Pval = (uint64_t *) arena_alloc(&Netarena, Nnodes * PWORDS * sizeof(uint64_t));
+  for (i = 0; i < Npi; i++) Pval[Cpi[i]] = (pat[i] == '1');
+  parallel_sim(Pval, 1);
+  for (i = 0; i < Nnodes; i++) Cval[i] = Pval[i] & 1;
+}
+
+/*-----------------------------------------------------------------------
+input: arena, number of bytes
+output: pointer to the allocated memory
+called by: fault_list_propogate, arena_zalloc and the engines
+description:
+  Bump allocation from an arena. Blocks are chained and kept on reset,
+  so once an arena has grown to its working size it no longer calls
+  malloc. Requests are rounded up to 8 bytes; inuse and peak follow the
+  bytes handed out for STATS.
+-----------------------------------------------------------------------*/
+void *arena_alloc(ARENA *a, size_t n)
+{
+  ABLOCK *b;
+  size_t sz;
+
+  n = (n + 7) & ~(size_t) 7;
+  while (a->cur != NULL && a->cur->used + n > a->cur->size) {
+    if (a->cur->next == NULL) break;
+    a->cur = a->cur->next;
+    a->cur->used = 0;
+  }
+  if (a->cur == NULL || a->cur->used + n > a->cur->size) {
+    sz = (n > a->bsize) ? n : a->bsize;
+    b = (ABLOCK *) malloc(sizeof(ABLOCK) + sz);
+    Stats.ablocks += sizeof(ABLOCK) + sz;
+    b->next = NULL;
+    b->size = sz;
+    b->used = 0;
+    if (a->cur == NULL) a->first = b;
+    else a->cur->next = b;
+    a->cur = b;
+  }
+  a->cur->used += n;
+  a->inuse += n;
+  if (a->inuse > a->peak) a->peak = a->inuse;
+  Stats.abytes += n;
+  return a->cur->data + a->cur->used - n;
+}
+
+/*-----------------------------------------------------------------------
+input: arena, number of bytes
+output: pointer to the allocated memory, zeroed
+called by: allocate, lev, cfs, mt_fault_simulation, atpg_init, ...
+description:
+  arena_alloc for what used calloc.
+-----------------------------------------------------------------------*/
+void *arena_zalloc(ARENA *a, size_t n)
+{
+  return memset(arena_alloc(a, n), 0, n);
+}
+
+/*-----------------------------------------------------------------------
+input: arena
+output: bytes held in its blocks
+called by: stats
+description:
+  Memory the arena keeps from the system, used or not.
+-----------------------------------------------------------------------*/
+size_t arena_size(ARENA *a)
+{
+  ABLOCK *b;
+  size_t n = 0;
+
+  for (b = a->first; b != NULL; b = b->next) n += sizeof(ABLOCK) + b->size;
+  return n;
+}
+
+/*-----------------------------------------------------------------------
+input: arena
+output: nothing
+called by: deductive_fault_simulation, main, bench
+description:
+  Release everything allocated from the arena in O(1). The blocks are
+  kept for the next pattern or command.
+-----------------------------------------------------------------------*/
+void arena_reset(ARENA *a)
+{
+  a->cur = a->first;
+  if (a->cur != NULL) a->cur->used = 0;
+  a->inuse = 0;
+}
+
+/*-----------------------------------------------------------------------
+input: arena
+output: nothing
+called by: clear
+description:
+  Return all blocks of the arena to the system. The peak is kept.
+-----------------------------------------------------------------------*/
+void arena_free(ARENA *a)
+{
+  ABLOCK *b, *next;
+
+  for (b = a->first; b != NULL; b = next) {
+    next = b->next;
+    free(b);
+  }
+  a->first = a->cur = NULL;
+  a->inuse = 0;
+}
+
+/*-----------------------------------------------------------------------
+input: two sorted fault lists and their sizes, output list
+output: size of the output list
+called by: fault_list_propogate
+description:
+  Set operations on sorted fault lists by a linear merge. The result is
+  written to z, which must hold nx + ny entries for union_op and xor_op
+  and nx entries otherwise. No memory is allocated.
+-----------------------------------------------------------------------*/
+int union_op(int *x, int nx, int *y, int ny, int *z)
+{
+  int i = 0, j = 0, n = 0;
+
+  while (i < nx && j < ny) {
+    if (x[i] < y[j]) z[n++] = x[i++];
+    else if (x[i] > y[j]) z[n++] = y[j++];
+    else {
+      z[n++] = x[i++];
+      j++;
+    }
+  }
+  while (i < nx) z[n++] = x[i++];
+  while (j < ny) z[n++] = y[j++];
+  return n;
+}
+
+int intersaction_op(int *x, int nx, int *y, int ny, int *z)
+{
+  int i = 0, j = 0, n = 0;
+
+  while (i < nx && j < ny) {
+    if (x[i] < y[j]) i++;
+    else if (x[i] > y[j]) j++;
+    else {
+      z[n++] = x[i++];
+      j++;
+    }
+  }
+  return n;
+}
+
+int minus_op(int *x, int nx, int *y, int ny, int *z)
+{
+  int i = 0, j = 0, n = 0;
+
+  while (i < nx && j < ny) {
+    if (x[i] < y[j]) z[n++] = x[i++];
+    else if (x[i] > y[j]) j++;
+    else {
+      i++;
+      j++;
+    }
+  }
+  while (i < nx) z[n++] = x[i++];
+  return n;
+}
+
+int xor_op(int *x, int nx, int *y, int ny, int *z)
+{
+  int i = 0, j = 0, n = 0;
+
+  while (i < nx && j < ny) {
+    if (x[i] < y[j]) z[n++] = x[i++];
+    else if (x[i] > y[j]) z[n++] = y[j++];
+    else {
+      i++;
+      j++;
+    }
+  }
+  while (i < nx) z[n++] = x[i++];
+  while (j < ny) z[n++] = y[j++];
+  return n;
+}
+
+/*-----------------------------------------------------------------------
+input: optional pattern file name, optional report file name
+output: nothing
+called by: main
+description:
+  Deductive fault simulation. Every node carries the sorted list of the
+  faults that flip its value, built from its fanin lists in level order
+  by fault_list_propogate. The lists live in a per-pattern arena that
+  is reset before the next pattern, so memory follows the actual list
+  sizes. The faults detected by a pattern are the union of the primary
+  output lists. Without a pattern file the node values of the last FFS
+  are used: the lists of the primary outputs are printed at verbosity 1,
+  those of every node at verbosity 2, and the number of faults the
+  pattern detects is always reported.
+-----------------------------------------------------------------------*/
+int deductive_fault_simulation(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE], *pat, *hit;
+  FILE *fd, *fo;
+  NSTRUC *np;
+  int i, j, p, n, npat, ndet, nz;
+  int *z, *t, *u;
+
+  if (Dfl == NULL) {
+    Dfl = (int **) arena_alloc(&Netarena, Nnodes * sizeof(int *));
+    Dfn = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+  }
+  if (Stats.nlev != Maxlevel + 1) {            /* per-level list sizes of STATS */
+    Stats.nlev = Maxlevel + 1;
+    Stats.flsum = (uint64_t *) realloc(Stats.flsum, Stats.nlev * sizeof(uint64_t));
+    Stats.flcnt = (uint64_t *) realloc(Stats.flcnt, Stats.nlev * sizeof(uint64_t));
+    Stats.flmax = (uint64_t *) realloc(Stats.flmax, Stats.nlev * sizeof(uint64_t));
+    memset(Stats.flsum, 0, Stats.nlev * sizeof(uint64_t));
+    memset(Stats.flcnt, 0, Stats.nlev * sizeof(uint64_t));
+    memset(Stats.flmax, 0, Stats.nlev * sizeof(uint64_t));
+  }
+  n = sscanf(cp, "%s %s", fin, fout);
+  if (n < 1) {
+    arena_reset(&Patarena);
+    for (p = 0; p < Nnodes; p++) fault_list_propogate(p);
+    Stats.evals += Nnodes;
+    n = (Verbose >= 2) ? Nnodes : (Verbose >= 1) ? Npo : 0;
+    for (i = 0; i < n; i++) {
+      np = (Verbose >= 2) ? &Node[i] : Poutput[i];
+      p = Cpos[np->indx];
+      printf("node:%d type:%s level :%d\n", np->num, gname(np->type), np->level);
+      for (j = 0; j < Dfn[p]; j++)
+        printf("%d/%d ", Node[Dfl[p][j] >> 1].num, Dfl[p][j] & 1);
+      printf("\n\n");
+    }
+    hit = arena_zalloc(&Runarena, 2 * Nnodes);
+    ndet = 0;
+    for (i = 0; i < Npo; i++)
+      for (j = 0; j < Dfn[Cpo[i]]; j++)
+        if (!hit[Dfl[Cpo[i]][j]]) {
+          hit[Dfl[Cpo[i]][j]] = 1;
+          ndet++;
+        }
+    printf("==> %d of %d faults detected (%.2f%%)\n", ndet, 2 * Nnodes,
+           Nnodes ? 50.0 * ndet / Nnodes : 0.0);
+    return 1;
+  }
+  if ((fd = fopen(fin, "r")) == NULL) {
+    printf("File %s does not exist!\n", fin);
+    return 0;
+  }
+  fo = stdout;
+  if (n == 2 && (fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    fclose(fd);
+    return 0;
+  }
+  pat = arena_alloc(&Runarena, Npi + 1);
+  hit = arena_zalloc(&Runarena, 2 * Nnodes);
+  npat = ndet = 0;
+
+  while (read_pattern(fd, pat)) {
+    logic_sim(pat);
+    arena_reset(&Patarena);
+    for (p = 0; p < Nnodes; p++) fault_list_propogate(p);
+    Stats.evals += Nnodes;
+
+    /* detected faults: union of the primary output lists */
+    nz = 0;
+    for (i = 0; i < Npo; i++) nz += Dfn[Cpo[i]];
+    z = arena_alloc(&Patarena, nz * sizeof(int));
+    t = arena_alloc(&Patarena, nz * sizeof(int));
+    nz = 0;
+    for (i = 0; i < Npo; i++) {
+      nz = union_op(z, nz, Dfl[Cpo[i]], Dfn[Cpo[i]], t);
+      u = z; z = t; t = u;
+    }
+    fprintf(fo, "pattern %d:", npat++);
+    for (i = 0; i < nz; i++) {
+      fprintf(fo, " %d/%d", Node[z[i] >> 1].num, z[i] & 1);
+      if (!hit[z[i]]) {
+        hit[z[i]] = 1;
+        ndet++;
+      }
+    }
+    fprintf(fo, "\n");
+  }
+
+  fclose(fd);
+  if (fo != stdout) fclose(fo);
+  if (Verbose >= 1)
+    printf("==> %d patterns, %d of %d faults detected (%.2f%%)\n", npat, ndet,
+           2 * Nnodes, Nnodes ? 50.0 * ndet / Nnodes : 0.0);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: position
+output: 1
+called by: deductive_fault_simulation
+description:
+  Build the fault list of a node from the lists of its fanins. A branch
+  or inverter passes its input list on and an XOR takes the symmetric
+  difference of its inputs. For AND/NAND/OR/NOR, when no input is at the
+  controlling value the list is the union of the input lists; otherwise
+  it is the intersection of the lists of the controlling inputs minus
+  the union of the others. Finally the node's own stuck-at-(not value)
+  fault is added. Intermediate lists go to the scratch buffers Ltmp and
+  only the final list is stored in the pattern arena.
+-----------------------------------------------------------------------*/
+int fault_list_propogate(int p){
+  int i, n, c, f, l, nin, bound, own, *x, *y, *t;
+  uint32_t *in, u;
+
+  in = &Cfan[Cfin[p]];
+  nin = Cfin[p + 1] - Cfin[p];
+  bound = 1;
+  for (i = 0; i < nin; i++) bound += Dfn[in[i]];
+  if (bound > Ltmpsize) {
+    Ltmpsize = 2 * bound;
+    Ltmp[0] = realloc(Ltmp[0], Ltmpsize * sizeof(int));
+    Ltmp[1] = realloc(Ltmp[1], Ltmpsize * sizeof(int));
+  }
+  x = Ltmp[0];
+  y = Ltmp[1];
+  n = 0;
+
+  switch (Ctype[p]) {
+    case IPT:
+      break;
+    case BRCH:
+    case NOT:
+      memcpy(x, Dfl[in[0]], Dfn[in[0]] * sizeof(int));
+      n = Dfn[in[0]];
+      break;
+    case XOR:
+      for (i = 0; i < nin; i++) {
+        n = xor_op(x, n, Dfl[in[i]], Dfn[in[i]], y);
+        t = x; x = y; y = t;
+      }
+      break;
+    case OR:
+    case NOR:
+    case NAND:
+    case AND:
+      c = (Ctype[p] == OR || Ctype[p] == NOR);     /* controlling value */
+      for (f = 0; f < nin && Cval[in[f]] != c; f++);
+      if (f == nin) {                              /* no input at control value */
+        for (i = 0; i < nin; i++) {
+          n = union_op(x, n, Dfl[in[i]], Dfn[in[i]], y);
+          t = x; x = y; y = t;
+        }
+        break;
+      }
+      memcpy(x, Dfl[in[f]], Dfn[in[f]] * sizeof(int));   /* first controlling input */
+      n = Dfn[in[f]];
+      for (i = 0; i < nin; i++) {
+        if (i == f) continue;
+        u = in[i];
+        if (Cval[u] == c) n = intersaction_op(x, n, Dfl[u], Dfn[u], y);
+        else n = minus_op(x, n, Dfl[u], Dfn[u], y);
+        t = x; x = y; y = t;
+      }
+      break;
+  }
+
+  /* store the list with the node's own fault in sorted position */
+  own = 2 * Lorder[p] + !Cval[p];
+  Dfl[p] = arena_alloc(&Patarena, (n + 1) * sizeof(int));
+  for (i = 0; i < n && x[i] < own; i++) Dfl[p][i] = x[i];
+  Dfl[p][i] = own;
+  memcpy(Dfl[p] + i + 1, x + i, (n - i) * sizeof(int));
+  Dfn[p] = n + 1;
+  l = Clevel[p];
+  Stats.flsum[l] += n + 1;
+  Stats.flcnt[l]++;
+  if (n + 1 > Stats.flmax[l]) Stats.flmax[l] = n + 1;
+  TRACE(p, -1, "dfs: node %d = %d, %d faults\n", Node[Lorder[p]].num, Cval[p], Dfn[p]);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: output bitset, two input bitsets, number of words
+output: nothing
+called by: bitset_propogate
+description:
+  Word-wide set kernels of the bitset deductive simulator: z = x | y,
+  x & y, x & ~y and x ^ y. They run 256 bits per step with AVX2 and
+  128 bits with SSE2, falling back to 64-bit words for the tail. z may
+  alias x or y.
+-----------------------------------------------------------------------*/
+#if defined(__AVX2__)
+#define BITS_KERNEL(name, vop, op)                                        \
+void name(uint64_t *z, uint64_t *x, uint64_t *y, int n)                  \
+{                                                                        \
+  int i = 0;                                                             \
+  __m256i a, b;                                                          \
+  for (; i + 4 <= n; i += 4) {                                           \
+    a = _mm256_loadu_si256((__m256i *) (x + i));                         \
+    b = _mm256_loadu_si256((__m256i *) (y + i));                         \
+    _mm256_storeu_si256((__m256i *) (z + i), vop);                       \
+  }                                                                      \
+  for (; i < n; i++) z[i] = op;                                          \
+}
+BITS_KERNEL(bits_or, _mm256_or_si256(a, b), x[i] | y[i])
+BITS_KERNEL(bits_and, _mm256_and_si256(a, b), x[i] & y[i])
+BITS_KERNEL(bits_andn, _mm256_andnot_si256(b, a), x[i] & ~y[i])
+BITS_KERNEL(bits_xor, _mm256_xor_si256(a, b), x[i] ^ y[i])
+#elif defined(__SSE2__)
+#define BITS_KERNEL(name, vop, op)                                        \
+void name(uint64_t *z, uint64_t *x, uint64_t *y, int n)                  \
+{                                                                        \
+  int i = 0;                                                             \
+  __m128i a, b;                                                          \
+  for (; i + 2 <= n; i += 2) {                                           \
+    a = _mm_loadu_si128((__m128i *) (x + i));                            \
+    b = _mm_loadu_si128((__m128i *) (y + i));                            \
+    _mm_storeu_si128((__m128i *) (z + i), vop);                          \
+  }                                                                      \
+  for (; i < n; i++) z[i] = op;                                          \
+}
+BITS_KERNEL(bits_or, _mm_or_si128(a, b), x[i] | y[i])
+BITS_KERNEL(bits_and, _mm_and_si128(a, b), x[i] & y[i])
+BITS_KERNEL(bits_andn, _mm_andnot_si128(b, a), x[i] & ~y[i])
+BITS_KERNEL(bits_xor, _mm_xor_si128(a, b), x[i] ^ y[i])
+#else
+#define BITS_KERNEL(name, vop, op)                                        \
+void name(uint64_t *z, uint64_t *x, uint64_t *y, int n)                  \
+{                                                                        \
+  int i;                                                                 \
+  for (i = 0; i < n; i++) z[i] = op;                                     \
+}
+BITS_KERNEL(bits_or, 0, x[i] | y[i])
+BITS_KERNEL(bits_and, 0, x[i] & y[i])
+BITS_KERNEL(bits_andn, 0, x[i] & ~y[i])
+BITS_KERNEL(bits_xor, 0, x[i] ^ y[i])
+#endif
+
+/*-----------------------------------------------------------------------
+input: position, fault list bitsets of all positions, words per bitset
+output: nothing
+called by: bitset_dfs
+description:
+  Bitset version of fault_list_propogate. Bit 2 * indx + v of a node's
+  bitset is set when the stuck-at-v fault of line indx flips the node.
+  The gate rules are the same, with union, intersection and difference
+  done by the bits_* kernels.
+-----------------------------------------------------------------------*/
+void bitset_propogate(int p, uint64_t *fl, int nw)
+{
+  uint64_t *z, *u;
+  uint32_t *in;
+  int i, c, f, n, own;
+
+  z = &fl[(size_t) p * nw];
+  in = &Cfan[Cfin[p]];
+  n = Cfin[p + 1] - Cfin[p];
+  memset(z, 0, nw * sizeof(uint64_t));
+  switch (Ctype[p]) {
+    case IPT:
+      break;
+    case BRCH:
+    case NOT:
+      memcpy(z, &fl[(size_t) in[0] * nw], nw * sizeof(uint64_t));
+      break;
+    case XOR:
+      for (i = 0; i < n; i++) bits_xor(z, z, &fl[(size_t) in[i] * nw], nw);
+      break;
+    case OR:
+    case NOR:
+    case NAND:
+    case AND:
+      c = (Ctype[p] == OR || Ctype[p] == NOR);
+      for (f = 0; f < n && Cval[in[f]] != c; f++);
+      if (f == n) {
+        for (i = 0; i < n; i++) bits_or(z, z, &fl[(size_t) in[i] * nw], nw);
+        break;
+      }
+      memcpy(z, &fl[(size_t) in[f] * nw], nw * sizeof(uint64_t));
+      for (i = 0; i < n; i++) {
+        if (i == f) continue;
+        u = &fl[(size_t) in[i] * nw];
+        if (Cval[in[i]] == c) bits_and(z, z, u, nw);
+        else bits_andn(z, z, u, nw);
+      }
+      break;
+  }
+  own = 2 * Lorder[p] + !Cval[p];
+  z[own >> 6] |= 1ULL << (own & 63);
+}
+
+/*-----------------------------------------------------------------------
+input: pattern file name, optional report file name
+output: nothing
+called by: main
+description:
+  Deductive fault simulation with one packed bitset per node, 2 bits per
+  line (stuck-at-0 and stuck-at-1), instead of sorted fault lists. All
+  bitsets are allocated once per run. Each set operation costs 2 *
+  Nnodes / 64 words regardless of list size, so this engine pays off
+  when the lists are dense, on mid-sized circuits. Output is the same
+  as DFS.
+-----------------------------------------------------------------------*/
+int bitset_dfs(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE], *pat, *hit;
+  FILE *fd, *fo;
+  uint64_t *fl, *det, w;
+  int i, n, nw, id, npat, ndet;
+
+  n = sscanf(cp, "%s %s", fin, fout);
+  if (n < 1) {
+    printf("Usage: BDFS patfile [outfile]\n");
+    return 0;
+  }
+  nw = (2 * Nnodes + 63) / 64;
+  if ((double) Nnodes * nw * sizeof(uint64_t) > (double) (1UL << 30)) {
+    printf("Fault list bitsets would exceed 1 GB, use DFS!\n");
+    return 0;
+  }
+  if ((fd = fopen(fin, "r")) == NULL) {
+    printf("File %s does not exist!\n", fin);
+    return 0;
+  }
+  fo = stdout;
+  if (n == 2 && (fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    fclose(fd);
+    return 0;
+  }
+  fl = (uint64_t *) arena_alloc(&Runarena, (size_t) Nnodes * nw * sizeof(uint64_t));
+  det = (uint64_t *) arena_alloc(&Runarena, nw * sizeof(uint64_t));
+  pat = arena_alloc(&Runarena, Npi + 1);
+  hit = arena_zalloc(&Runarena, 2 * Nnodes);
+  npat = ndet = 0;
+
+  while (read_pattern(fd, pat)) {
+    logic_sim(pat);
+    for (i = 0; i < Nnodes; i++) bitset_propogate(i, fl, nw);
+    Stats.evals += Nnodes;
+    memset(det, 0, nw * sizeof(uint64_t));
+    for (i = 0; i < Npo; i++)
+      bits_or(det, det, &fl[(size_t) Cpo[i] * nw], nw);
+    fprintf(fo, "pattern %d:", npat++);
+    for (i = 0; i < nw; i++) {
+      for (w = det[i]; w; w &= w - 1) {
+        id = 64 * i + __builtin_ctzll(w);
+        fprintf(fo, " %d/%d", Node[id >> 1].num, id & 1);
+        if (!hit[id]) {
+          hit[id] = 1;
+          ndet++;
+        }
+      }
+    }
+    fprintf(fo, "\n");
+  }
+
+  fclose(fd);
+  if (fo != stdout) fclose(fo);
+  if (Verbose >= 1)
+    printf("==> %d patterns, %d of %d faults detected (%.2f%%)\n", npat, ndet,
+           2 * Nnodes, Nnodes ? 50.0 * ndet / Nnodes : 0.0);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: position, values of its fanins
+output: value of the node
+called by: cfs_evaluate
+description:
+  Two-valued evaluation of one gate from an array of fanin values.
+-----------------------------------------------------------------------*/
+int gate_eval(int p, int *in)
+{
+  int i, v, n;
+
+  n = Cfin[p + 1] - Cfin[p];
+  switch (Ctype[p]) {
+    case BRCH:
+      return in[0];
+    case NOT:
+      return !in[0];
+    case XOR:
+      for (i = v = 0; i < n; i++) v ^= in[i];
+      return v;
+    case OR:
+    case NOR:
+      for (i = v = 0; i < n; i++) v |= in[i];
+      return (Ctype[p] == NOR) ? !v : v;
+    case NAND:
+    case AND:
+      for (i = 0, v = 1; i < n; i++) v &= in[i];
+      return (Ctype[p] == NAND) ? !v : v;
+  }
+  return in[0];
+}
+
+/*-----------------------------------------------------------------------
+input: position, good values, concurrent fault lists, dropped or
+       untargeted faults, scratch list
+output: 1 if the good value or the fault list of the node changed
+called by: concurrent_fault_simulation
+description:
+  Re-evaluate the good machine and every faulty machine that reaches the
+  node. The candidates are the union of the fanin lists plus the local
+  faults of the node, visited in sorted order by a merge over the fanin
+  lists. For each candidate the fanins in whose list it appears take the
+  complement of their good value. A record is kept only when the faulty
+  value differs from the good one, so the list stays empty where the
+  faulty machines agree with the good machine. Primary inputs get their
+  good value from the caller.
+-----------------------------------------------------------------------*/
+int cfs_evaluate(int p, int *gv, CFLIST *cl, char *drop, int *scratch)
+{
+  int nin = Cfin[p + 1] - Cfin[p];
+  int in[nin > 0 ? nin : 1], cur[nin > 0 ? nin : 1];
+  int i, f, g, n, changed;
+  uint32_t *up;
+  CFLIST *c, *u;
+
+  c = &cl[p];
+  up = &Cfan[Cfin[p]];
+  if (Ctype[p] == IPT) g = gv[p];
+  else {
+    for (i = 0; i < nin; i++) in[i] = gv[up[i]];
+    g = gate_eval(p, in);
+  }
+
+  n = 0;
+  for (i = 0; i < nin; i++) cur[i] = 0;
+  while (1) {
+    /* next candidate: smallest id at the fanin list cursors */
+    f = INT32_MAX;
+    for (i = 0; i < nin; i++) {
+      u = &cl[up[i]];
+      while (cur[i] < u->n && drop[u->f[cur[i]]]) cur[i]++;
+      if (cur[i] < u->n && u->f[cur[i]] < f) f = u->f[cur[i]];
+    }
+    if (f == INT32_MAX) break;
+    for (i = 0; i < nin; i++) {
+      u = &cl[up[i]];
+      in[i] = gv[up[i]];
+      if (cur[i] < u->n && u->f[cur[i]] == f) {
+        in[i] = !in[i];
+        cur[i]++;
+      }
+    }
+    if (gate_eval(p, in) != g) scratch[n++] = f;
+  }
+
+  /* local fault: stuck at the complement of the good value */
+  f = 2 * Lorder[p] + !g;
+  if (!drop[f]) {
+    for (i = n; i > 0 && scratch[i - 1] > f; i--) scratch[i] = scratch[i - 1];
+    scratch[i] = f;
+    n++;
+  }
+
+  changed = (g != gv[p]) || (n != c->n) ||
+            memcmp(scratch, c->f, n * sizeof(int));
+  gv[p] = g;
+  if (n > c->cap) {
+    c->cap = 2 * n;
+    c->f = realloc(c->f, c->cap * sizeof(int));
+  }
+  memcpy(c->f, scratch, n * sizeof(int));
+  c->n = n;
+  return changed;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern file name, optional report file name
+output: nothing
+called by: main
+description:
+  Event-driven concurrent fault simulation. Every node keeps only the
+  faulty machines whose value differs from the good machine there.
+  Between patterns only the primary inputs that change are scheduled,
+  and a node schedules its fanouts only when its good value or its list
+  changed, so quiet parts of the circuit are never touched. The event
+  queue is bucketed by the level from lev(): level l can hold at most
+  the nodes of that level, so the buckets share the Lorder layout.
+  Faults outside the target list are never started and detected faults
+  are dropped. The newly detected faults of each pattern are reported.
+-----------------------------------------------------------------------*/
+int concurrent_fault_simulation(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE], *pat, *drop, *inq;
+  FILE *fd, *fo;
+  CFLIST *cl, *c;
+  int i, j, k, l, n, p, npat, ndet, nevents, first;
+  int *queue, *qn, *scratch, *gv;
+
+  n = sscanf(cp, "%s %s", fin, fout);
+  if (n < 1) {
+    printf("Usage: CFS patfile [outfile]\n");
+    return 0;
+  }
+  if (build_target_faults() < 0) return 0;
+  if ((fd = fopen(fin, "r")) == NULL) {
+    printf("File %s does not exist!\n", fin);
+    return 0;
+  }
+  fo = stdout;
+  if (n == 2 && (fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    fclose(fd);
+    return 0;
+  }
+  cl = (CFLIST *) arena_zalloc(&Runarena, Nnodes * sizeof(CFLIST));
+  gv = (int *) arena_alloc(&Runarena, Nnodes * sizeof(int));
+  drop = arena_alloc(&Runarena, 2 * Nnodes);
+  memset(drop, 1, 2 * Nnodes);
+  for (i = 0; i < Nflist; i++) drop[Flist[i]] = 0;
+  inq = arena_zalloc(&Runarena, Nnodes);
+  queue = (int *) arena_alloc(&Runarena, Nnodes * sizeof(int));
+  qn = (int *) arena_zalloc(&Runarena, (Maxlevel + 1) * sizeof(int));
+  scratch = (int *) arena_alloc(&Runarena, (2 * Nnodes + 1) * sizeof(int));
+  pat = arena_alloc(&Runarena, Npi + 1);
+  npat = ndet = nevents = 0;
+  first = 1;
+
+  while (read_pattern(fd, pat)) {
+    for (i = 0; i < Npi; i++) {
+      p = Cpi[i];
+      if (first || gv[p] != (pat[i] == '1')) {
+        gv[p] = (pat[i] == '1');
+        cl[p].n = -1;                              /* force an event */
+        queue[Loffset[0] + qn[0]++] = p;
+        inq[p] = 1;
+      }
+    }
+    if (first) {
+      for (p = Loffset[1]; p < Nnodes; p++) {
+        gv[p] = -1;
+        queue[Loffset[Clevel[p]] + qn[Clevel[p]]++] = p;
+        inq[p] = 1;
+      }
+      first = 0;
+    }
+
+    for (l = 0; l <= Maxlevel; l++) {
+      for (k = 0; k < qn[l]; k++) {
+        p = queue[Loffset[l] + k];
+        inq[p] = 0;
+        nevents++;
+        if (!cfs_evaluate(p, gv, cl, drop, scratch)) continue;
+        for (j = Cfout[p]; j < Cfout[p + 1]; j++) {
+          n = Cdfan[j];
+          if (inq[n]) continue;
+          inq[n] = 1;
+          queue[Loffset[Clevel[n]] + qn[Clevel[n]]++] = n;
+        }
+      }
+      qn[l] = 0;
+    }
+
+    fprintf(fo, "pattern %d:", npat++);
+    for (i = 0; i < Npo; i++) {
+      c = &cl[Cpo[i]];
+      for (j = 0; j < c->n; j++) {
+        if (drop[c->f[j]]) continue;
+        drop[c->f[j]] = 1;
+        ndet++;
+        fprintf(fo, " %d/%d", Node[c->f[j] >> 1].num, c->f[j] & 1);
+      }
+    }
+    fprintf(fo, "\n");
+  }
+
+  fclose(fd);
+  if (fo != stdout) fclose(fo);
+  Stats.evals += nevents;
+  Stats.events += nevents;
+  if (Verbose >= 1)
+    printf("==> %d patterns, %d gate evaluations, %d of %d faults detected (%.2f%%)\n",
+           npat, nevents, ndet, Nflist, Nflist ? 100.0 * ndet / Nflist : 0.0);
+  for (i = 0; i < Nnodes; i++) free(cl[i].f);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: PPSFP work buffers
+output: nothing
+called by: ppsfp
+description:
+  Allocate the buffers one fault propagation needs. Each worker owns a
+  PPSTRUC, so several can share the read-only good machine values. The
+  buffers come from Runarena and go with the command; ppsfp_free only
+  adds the counters to STATS.
+-----------------------------------------------------------------------*/
+void ppsfp_init(PPSTRUC *w)
+{
+  int i;
+
+  w->fval = (uint64_t *) arena_alloc(&Runarena, Nnodes * sizeof(uint64_t));
+  w->stamp = (int *) arena_zalloc(&Runarena, Nnodes * sizeof(int));
+  w->qstamp = (int *) arena_zalloc(&Runarena, Nnodes * sizeof(int));
+  w->queue = (int *) arena_alloc(&Runarena, Nnodes * sizeof(int));
+  w->qn = (int *) arena_zalloc(&Runarena, (Maxlevel + 1) * sizeof(int));
+  w->mark = 0;
+  w->nevals = w->nevents = 0;
+  if (Pomark == NULL) {
+    Pomark = arena_zalloc(&Netarena, Nnodes);
+    for (i = 0; i < Npo; i++) Pomark[Cpo[i]] = 1;
+  }
+}
+
+void ppsfp_free(PPSTRUC *w)
+{
+  Stats.evals += w->nevals;
+  Stats.events += w->nevents;
+}
+
+/*-----------------------------------------------------------------------
+input: position, PPSFP work buffers, good machine values
+output: value word of the node in the faulty machine
+called by: ppsfp_fault
+description:
+  Same as eval_word for one word, except that a fanin reached by the
+  fault contributes its faulty value instead of its good value.
+-----------------------------------------------------------------------*/
+#define FVAL(u) (w->stamp[u] == w->mark ? w->fval[u] : good[u])
+uint64_t eval_fault_word(int p, PPSTRUC *w, uint64_t *good)
+{
+  uint64_t v;
+  uint32_t *in;
+  int i, n;
+
+  in = &Cfan[Cfin[p]];
+  n = Cfin[p + 1] - Cfin[p];
+  switch (Ctype[p]) {
+    case BRCH:
+      return FVAL(in[0]);
+    case NOT:
+      return ~FVAL(in[0]);
+    case XOR:
+      for (i = 0, v = 0; i < n; i++) v ^= FVAL(in[i]);
+      return v;
+    case OR:
+    case NOR:
+      for (i = 0, v = 0; i < n; i++) v |= FVAL(in[i]);
+      return (Ctype[p] == NOR) ? ~v : v;
+    case NAND:
+    case AND:
+      for (i = 0, v = ~0ULL; i < n; i++) v &= FVAL(in[i]);
+      return (Ctype[p] == NAND) ? ~v : v;
+  }
+  return good[p];
+}
+#undef FVAL
+
+/*-----------------------------------------------------------------------
+input: work buffers, fault id, good machine values, valid pattern bits,
+       whether to find every detecting pattern
+output: bits of the patterns that detect the fault
+called by: ppsfp, mt_run, batch, atpg, random_phase, tset_sim
+description:
+  Single fault propagation over 64 patterns at once. The fault is
+  injected at its site and only the nodes of its fanout cone that are
+  reached by a difference are evaluated, in level order through level
+  buckets. A node whose faulty word equals its good word stops the
+  propagation on that path. Unless full is set, the propagation stops
+  as soon as a primary output sees the difference of the first pattern
+  that excites the fault, as no earlier pattern can detect it. Either
+  way the lowest bit of the result is the first detecting pattern of
+  the block, which is what fault dropping reports.
+-----------------------------------------------------------------------*/
+uint64_t ppsfp_fault(PPSTRUC *w, int fid, uint64_t *good, uint64_t valid, int full)
+{
+  uint64_t v, d, det, first;
+  int i, j, k, l, p, q, lmax;
+
+  p = Cpos[fid >> 1];
+  v = (fid & 1) ? ~0ULL : 0;
+  d = (v ^ good[p]) & valid;
+  if (d == 0) return 0;
+  first = d & -d;
+  if (++w->mark == 0) {                        /* stamps wrapped around */
+    memset(w->stamp, 0, Nnodes * sizeof(int));
+    memset(w->qstamp, 0, Nnodes * sizeof(int));
+    w->mark = 1;
+  }
+  w->fval[p] = v;
+  w->stamp[p] = w->mark;
+  det = Pomark[p] ? d : 0;
+  TRACE(p, fid, "ppsfp: fault %d/%d excited %016llx\n", Node[fid >> 1].num, fid & 1,
+        (unsigned long long) d);
+  if (det && !full) return det;
+
+  lmax = Clevel[p];
+  for (j = Cfout[p]; j < Cfout[p + 1]; j++) {
+    q = Cdfan[j];
+    w->qstamp[q] = w->mark;
+    w->queue[Loffset[Clevel[q]] + w->qn[Clevel[q]]++] = q;
+    if (Clevel[q] > lmax) lmax = Clevel[q];
+  }
+  w->nevents += Cfout[p + 1] - Cfout[p];
+  for (l = Clevel[p] + 1; l <= lmax; l++) {
+    for (k = 0; k < w->qn[l]; k++) {
+      p = w->queue[Loffset[l] + k];
+      v = eval_fault_word(p, w, good);
+      w->nevals++;
+      d = (v ^ good[p]) & valid;
+      if (d == 0) continue;
+      w->fval[p] = v;
+      w->stamp[p] = w->mark;
+      if (Pomark[p]) {
+        det |= d;
+        if (!full && (det & first)) {
+          for (i = l; i <= lmax; i++) w->qn[i] = 0;
+          TRACE(Cpos[fid >> 1], fid, "ppsfp: fault %d/%d detected %016llx\n",
+                Node[fid >> 1].num, fid & 1, (unsigned long long) det);
+          return det;
+        }
+      }
+      for (j = Cfout[p]; j < Cfout[p + 1]; j++) {
+        q = Cdfan[j];
+        if (w->qstamp[q] == w->mark) continue;
+        w->qstamp[q] = w->mark;
+        w->queue[Loffset[Clevel[q]] + w->qn[Clevel[q]]++] = q;
+        w->nevents++;
+        if (Clevel[q] > lmax) lmax = Clevel[q];
+      }
+    }
+    w->qn[l] = 0;
+  }
+  return det;
+}
+
+/*-----------------------------------------------------------------------
+input: live fault list, detecting pattern of each live fault (-1 if
+       none), first pattern number of the block, patterns in the block,
+       report file
+output: number of faults dropped
+called by: ppsfp, mt_fault_simulation
+description:
+  Report the faults detected in a block of patterns, grouped by pattern,
+  and remove them from the live fault list.
+-----------------------------------------------------------------------*/
+int drop_detected(int *live, int nlive, int *detp, int base, int p, FILE *fo)
+{
+  int start[65], i, k, n, *order;
+
+  memset(start, 0, sizeof(start));
+  for (i = 0; i < nlive; i++)
+    if (detp[i] >= 0) start[detp[i] + 1]++;
+  for (k = 0; k < 64; k++) start[k + 1] += start[k];
+  n = start[64];
+  order = (int *) malloc((n + 1) * sizeof(int));
+  for (i = 0; i < nlive; i++)
+    if (detp[i] >= 0) order[start[detp[i]]++] = live[i];
+  for (k = i = 0; k < p; k++) {
+    fprintf(fo, "pattern %d:", base + k);
+    for (; i < start[k]; i++)
+      fprintf(fo, " %d/%d", Node[order[i] >> 1].num, order[i] & 1);
+    fprintf(fo, "\n");
+  }
+  for (i = k = 0; i < nlive; i++)
+    if (detp[i] < 0) live[k++] = live[i];
+  free(order);
+  stats_drop(n);
+  return n;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern file name, optional report file name
+output: nothing
+called by: main
+description:
+  Parallel-pattern single-fault propagation (PPSFP). Patterns are
+  streamed from the pattern file (pat_open) and taken 64 at a time; the
+  good machine is simulated bit-parallel once per block. Then every
+  fault still in the target list is propagated through its fanout cone
+  by ppsfp_fault and dropped as soon as one pattern of the block
+  detects it. The faults dropped by each pattern are reported.
+-----------------------------------------------------------------------*/
+int ppsfp(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE];
+  PATSTREAM ps;
+  FILE *fo;
+  PPSTRUC w;
+  uint64_t valid, det, *good, *in;
+  int i, k, p, n, base, nlive, ndet, np, *live, *detp;
+
+  n = sscanf(cp, "%s %s", fin, fout);
+  if (n < 1) {
+    printf("Usage: PPSFP patfile [outfile]\n");
+    return 0;
+  }
+  if (build_target_faults() < 0) return 0;
+  if (!pat_open(&ps, fin)) return 0;
+  fo = stdout;
+  if (n == 2 && (fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    pat_close(&ps);
+    return 0;
+  }
+  ppsfp_init(&w);
+  good = (uint64_t *) arena_alloc(&Runarena, Nnodes * sizeof(uint64_t));
+  live = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+  detp = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+  memcpy(live, Flist, Nflist * sizeof(int));
+  nlive = Nflist;
+  base = ndet = 0;
+
+  do {
+    np = pat_next(&ps, &in);
+    for (k = 0; k < np; k += 64) {
+      p = MIN(np - k, 64);
+      for (i = 0; i < Npi; i++) good[Cpi[i]] = in[i * PWORDS + (k >> 6)];
+      valid = (p == 64) ? ~0ULL : (1ULL << p) - 1;
+      parallel_sim(good, 1);
+      for (i = 0; i < nlive; i++) {
+        det = ppsfp_fault(&w, live[i], good, valid, 0);
+        detp[i] = det ? __builtin_ctzll(det) : -1;
+      }
+      n = drop_detected(live, nlive, detp, base, p, fo);
+      nlive -= n;
+      ndet += n;
+      base += p;
+      if (nlive == 0) break;
+    }
+    pat_done(&ps);
+  } while (np == PBITS && nlive > 0);
+
+  pat_close(&ps);
+  if (fo != stdout) fclose(fo);
+  if (Verbose >= 1)
+    printf("==> %d patterns, %d of %d faults detected (%.2f%%)\n", base, ndet,
+           Nflist, Nflist ? 100.0 * ndet / Nflist : 0.0);
+  ppsfp_free(&w);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: work-stealing deque
+output: first live-list index of a chunk of faults, -1 if empty
+called by: mt_run
+description:
+  The owner of a deque takes chunks from the bottom, thieves take them
+  from the top, so an owner and a thief only meet on the last chunk.
+-----------------------------------------------------------------------*/
+int deque_pop(WSDEQUE *dq)
+{
+  int c = -1;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->top < dq->bottom) c = dq->task[--dq->bottom];
+  pthread_mutex_unlock(&dq->lock);
+  return c;
+}
+
+int deque_steal(WSDEQUE *dq)
+{
+  int c = -1;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->top < dq->bottom) c = dq->task[dq->top++];
+  pthread_mutex_unlock(&dq->lock);
+  return c;
+}
+
+/*-----------------------------------------------------------------------
+input: worker
+output: nothing
+called by: mt_worker, mt_fault_simulation
+description:
+  Propagate the faults of the current block: first the worker's own
+  chunks, then chunks stolen from the other workers until every deque
+  is empty. The first detecting pattern of live fault i goes to
+  Mtdetp[i], which only the worker holding that chunk writes.
+-----------------------------------------------------------------------*/
+void mt_run(MTWORKER *me)
+{
+  uint64_t det;
+  int i, k, c, end;
+
+  while (1) {
+    c = deque_pop(&me->dq);
+    for (k = 1; c < 0 && k < Mtn; k++)
+      c = deque_steal(&Mtw[(me->id + k) % Mtn].dq);
+    if (c < 0) return;
+    end = (c + MTCHUNK < Mtnlive) ? c + MTCHUNK : Mtnlive;
+    for (i = c; i < end; i++) {
+      det = ppsfp_fault(&me->w, Mtlive[i], Mtgood, Mtvalid, 0);
+      Mtdetp[i] = det ? __builtin_ctzll(det) : -1;
+    }
+  }
+}
+
+void *mt_worker(void *arg)
+{
+  MTWORKER *me = (MTWORKER *) arg;
+
+  pthread_mutex_lock(&Mtstart);                /* Mtbar is set */
+  pthread_mutex_unlock(&Mtstart);
+  while (1) {
+    pthread_barrier_wait(&Mtbar);              /* block is ready */
+    if (Mtdone) break;
+    mt_run(me);
+    pthread_barrier_wait(&Mtbar);              /* block is finished */
+  }
+  return NULL;
+}
+
+/*-----------------------------------------------------------------------
+input: number of threads, pattern file name, optional report file name
+output: nothing
+called by: main
+description:
+  Multithreaded PPSFP. The netlist and the good machine values of each
+  64-pattern block are shared read-only; every worker has its own
+  PPSTRUC. The live faults are cut into chunks of MTCHUNK and handed
+  out in contiguous runs to per-worker deques; a worker that runs dry
+  steals from the others, so hard-to-drop faults do not leave cores
+  idle. The calling thread is worker 0. Dropping happens between blocks
+  and the detecting pattern of a fault, its first detection within the
+  block (see ppsfp_fault), depends only on the fault and the block, so
+  the merged results do not depend on the schedule and match PPSFP.
+  At most MTMAX threads are asked for; if fewer start, the workers and
+  the barrier are sized to those that did.
+-----------------------------------------------------------------------*/
+int mt_fault_simulation(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE], *pat;
+  FILE *fd, *fo;
+  pthread_t *tid;
+  int i, k, p, n, nth, base, ndet, nchunk;
+
+  n = sscanf(cp, "%d %s %s", &nth, fin, fout);
+  if (n < 2 || nth < 1 || nth > MTMAX) {
+    printf("Usage: MTFS nthreads patfile [outfile], nthreads 1..%d\n", MTMAX);
+    return 0;
+  }
+  if (build_target_faults() < 0) return 0;
+  if ((fd = fopen(fin, "r")) == NULL) {
+    printf("File %s does not exist!\n", fin);
+    return 0;
+  }
+  fo = stdout;
+  if (n == 3 && (fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    fclose(fd);
+    return 0;
+  }
+  Mtw = (MTWORKER *) arena_zalloc(&Runarena, nth * sizeof(MTWORKER));
+  for (i = 0; i < nth; i++) {
+    Mtw[i].id = i;
+    ppsfp_init(&Mtw[i].w);
+    Mtw[i].dq.task = (int *) arena_alloc(&Runarena, (Nflist / MTCHUNK + 1) * sizeof(int));
+    pthread_mutex_init(&Mtw[i].dq.lock, NULL);
+  }
+  Mtgood = (uint64_t *) arena_alloc(&Runarena, Nnodes * sizeof(uint64_t));
+  Mtlive = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+  Mtdetp = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+  memcpy(Mtlive, Flist, Nflist * sizeof(int));
+  Mtnlive = Nflist;
+  Mtdone = 0;
+  tid = (pthread_t *) arena_alloc(&Runarena, nth * sizeof(pthread_t));
+  pthread_mutex_lock(&Mtstart);        /* the barrier counts the threads that started */
+  for (i = 1; i < nth && pthread_create(&tid[i], NULL, mt_worker, &Mtw[i]) == 0; i++);
+  Mtn = i;
+  pthread_barrier_init(&Mtbar, NULL, Mtn);
+  pthread_mutex_unlock(&Mtstart);
+  if (Mtn < nth && Verbose >= 1) printf("Only %d of %d threads started\n", Mtn, nth);
+  pat = arena_alloc(&Runarena, Npi + 1);
+  base = ndet = 0;
+
+  do {
+    for (p = 0; p < 64 && read_pattern(fd, pat); p++) pack_pattern(pat, p, Mtgood, 1);
+    if (p == 0) break;
+    Mtvalid = (p == 64) ? ~0ULL : (1ULL << p) - 1;
+    parallel_sim(Mtgood, 1);
+
+    /* contiguous runs of chunks to each worker */
+    nchunk = (Mtnlive + MTCHUNK - 1) / MTCHUNK;
+    for (i = 0; i < Mtn; i++) {
+      Mtw[i].dq.top = Mtw[i].dq.bottom = 0;
+      for (k = nchunk * i / Mtn; k < nchunk * (i + 1) / Mtn; k++)
+        Mtw[i].dq.task[Mtw[i].dq.bottom++] = k * MTCHUNK;
+    }
+    pthread_barrier_wait(&Mtbar);
+    mt_run(&Mtw[0]);
+    pthread_barrier_wait(&Mtbar);
+
+    n = drop_detected(Mtlive, Mtnlive, Mtdetp, base, p, fo);
+    Mtnlive -= n;
+    ndet += n;
+    base += p;
+  } while (p == 64 && Mtnlive > 0);
+
+  Mtdone = 1;
+  pthread_barrier_wait(&Mtbar);
+  for (i = 1; i < Mtn; i++) pthread_join(tid[i], NULL);
+  pthread_barrier_destroy(&Mtbar);
+
+  fclose(fd);
+  if (fo != stdout) fclose(fo);
+  if (Verbose >= 1)
+    printf("==> %d threads, %d patterns, %d of %d faults detected (%.2f%%)\n", Mtn,
+           base, ndet, Nflist, Nflist ? 100.0 * ndet / Nflist : 0.0);
+  for (i = 0; i < nth; i++) {
+    ppsfp_free(&Mtw[i].w);
+    pthread_mutex_destroy(&Mtw[i].dq.lock);
+  }
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: MTSIM job
+output: NULL
+called by: mt_simulation
+description:
+  Worker of MTSIM. Claims pattern blocks from the shared counter, loads
+  the packed primary input words of the block into its own value array,
+  simulates and stores the primary output words in the block's slot of
+  the output buffer. Blocks never share a slot, so no locking is needed.
+  The sweep is parallel_sim's without its shared Stats counter, which
+  mt_simulation updates once for all workers.
+-----------------------------------------------------------------------*/
+void *mtsim_worker(void *arg)
+{
+  MTSJOB *job = (MTSJOB *) arg;
+  uint64_t *val;
+  int b, i, p, w;
+
+  val = (uint64_t *) malloc(Nnodes * PWORDS * sizeof(uint64_t));
+  while ((b = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->nblock) {
+    for (i = 0; i < Npi; i++)
+      for (w = 0; w < PWORDS; w++)
+        val[Cpi[i] * PWORDS + w] = job->piw[((size_t) b * Npi + i) * PWORDS + w];
+    for (p = Loffset[1]; p < Nnodes; p++) eval_word(p, val, PWORDS);
+    for (i = 0; i < Npo; i++)
+      for (w = 0; w < PWORDS; w++)
+        job->pow[((size_t) b * Npo + i) * PWORDS + w] = val[Cpo[i] * PWORDS + w];
+  }
+  free(val);
+  return NULL;
+}
+
+/*-----------------------------------------------------------------------
+input: number of threads, pattern file name, response file name
+output: nothing
+called by: main
+description:
+  Pattern-parallel multithreaded fault free simulation. The patterns
+  come from the pattern stream (text or binary) in batches of up to
+  MTSBATCH blocks of PBITS, each batch is simulated by nthreads workers
+  against the shared levelized netlist and its responses are written in
+  the PSIM format, binary for a ".bin" response file. Memory use does
+  not depend on the number of patterns. At most MTMAX threads are
+  asked for; workers claim blocks, so any that fail to start only
+  leave more blocks to the others, and the count drops to the threads
+  that ran.
+-----------------------------------------------------------------------*/
+int mt_simulation(cp)
+char *cp;
+{
+  char fin[MAXLINE], fout[MAXLINE];
+  PATSTREAM ps;
+  FILE *fo;
+  pthread_t *tid;
+  MTSJOB job;
+  uint64_t *in, total;
+  uint32_t *pos;
+  int b, i, p, last, nth, nrun, bin;
+
+  if (sscanf(cp, "%d %s %s", &nth, fin, fout) != 3 || nth < 1 || nth > MTMAX) {
+    printf("Usage: MTSIM nthreads patfile outfile, nthreads 1..%d\n", MTMAX);
+    return 0;
+  }
+  if (!pat_open(&ps, fin)) return 0;
+  if ((fo = resp_open(fout, Npo, &bin)) == NULL) {
+    pat_close(&ps);
+    return 0;
+  }
+  job.piw = (uint64_t *) arena_alloc(&Runarena, (size_t) MTSBATCH * Npi * PWORDS * sizeof(uint64_t));
+  job.pow = (uint64_t *) arena_alloc(&Runarena, (size_t) MTSBATCH * Npo * PWORDS * sizeof(uint64_t));
+  pos = (uint32_t *) arena_alloc(&Runarena, (Npo + 1) * sizeof(uint32_t));
+  for (i = 0; i < Npo; i++) pos[i] = i;
+  tid = (pthread_t *) arena_alloc(&Runarena, nth * sizeof(pthread_t));
+  total = 0;
+
+  do {
+    /* a batch of blocks, the last one possibly short */
+    for (b = 0, p = last = PBITS; b < MTSBATCH && p == PBITS; b++) {
+      p = pat_next(&ps, &in);
+      memcpy(&job.piw[(size_t) b * Npi * PWORDS], in, Npi * PWORDS * sizeof(uint64_t));
+      pat_done(&ps);
+      if (p == 0) break;
+      last = p;
+      total += p;
+    }
+    if (b == 0) break;
+    job.nblock = b;
+    job.next = 0;
+    for (nrun = 1; nrun < nth && pthread_create(&tid[nrun], NULL, mtsim_worker, &job) == 0; nrun++);
+    mtsim_worker(&job);                 /* blocks nobody claims are done here */
+    for (i = 1; i < nrun; i++) pthread_join(tid[i], NULL);
+    nth = nrun;                         /* later batches ask for no more */
+    Stats.evals += (uint64_t) job.nblock * (Nnodes - Loffset[1]) * PWORDS;
+    for (i = 0; i < job.nblock; i++)
+      resp_write(fo, bin, pos, Npo, &job.pow[(size_t) i * Npo * PWORDS], PWORDS,
+                 (i < job.nblock - 1) ? PBITS : last);
+  } while (p == PBITS);
+
+  pat_close(&ps);
+  resp_close(fo, bin, total);
+  if (Verbose >= 1)
+    printf("==> %d threads, %llu patterns simulated\n", nth, (unsigned long long) total);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: 64-bit hash
+called by: csim_load
+description:
+  Hash of the levelized netlist arrays. It names the compiled simulator
+  of a circuit, so an edited circuit never picks up a stale object.
+-----------------------------------------------------------------------*/
+uint64_t netlist_hash()
+{
+  uint64_t h;
+
+  h = text_hash((char *) Ctype, Nnodes);
+  h = h * 1099511628211ULL ^ text_hash((char *) Cfin, (Nnodes + 1) * sizeof(uint32_t));
+  h = h * 1099511628211ULL ^ text_hash((char *) Cfan, Cfin[Nnodes] * sizeof(uint32_t));
+  h = h * 1099511628211ULL ^ text_hash((char *) Cpi, Npi * sizeof(uint32_t));
+  h = h * 1099511628211ULL ^ text_hash((char *) Cpo, Npo * sizeof(uint32_t));
+  return (h * 1099511628211ULL ^ CSIMVERSION) * 1099511628211ULL ^ PWORDS;
+}
+
+/*-----------------------------------------------------------------------
+input: C file name
+output: 1 on success
+called by: csim_load
+description:
+  Write the netlist as straight-line C. Every node becomes a local of
+  PWORDS words (a GCC vector, one AVX2 register under PWORDS 4) assigned
+  by a single bitwise expression of its fanins, in level order. The
+  gates are cut into functions of CSIMCHUNK nodes so that the
+  compiler sees bounded functions on large circuits; a node is stored to
+  the value array only when a later chunk or a primary output needs it.
+  The entry point fsim_eval has the contract of parallel_sim for nw ==
+  PWORDS; the stride is a compile-time constant so every array access
+  is a fixed offset.
+-----------------------------------------------------------------------*/
+int csim_emit(char *name)
+{
+  static const char *op[] = {"", "", " ^ ", " | ", " | ", "", " & ", " & "};
+  FILE *fo;
+  uint32_t *in, j;
+  int i, a, b, p, n, nchunk;
+  char *po;
+
+  if ((fo = fopen(name, "w")) == NULL) {
+    printf("Cannot open %s!\n", name);
+    return 0;
+  }
+  po = calloc(Nnodes, 1);
+  for (i = 0; i < Npo; i++) po[Cpo[i]] = 1;
+  fprintf(fo, "#include <stdint.h>\n\n#define NW %d\n", PWORDS);
+  fprintf(fo, "typedef uint64_t W __attribute__((vector_size(NW * 8), aligned(8)));\n");
+  fprintf(fo, "#define V(p) (*(W *) &v[(p) * NW])\n");
+  nchunk = 0;
+  for (a = 0; a < Nnodes; a = b, nchunk++) {
+    b = (a + CSIMCHUNK < Nnodes) ? a + CSIMCHUNK : Nnodes;
+    fprintf(fo, "\n__attribute__((noinline)) static void chunk%d(uint64_t *v)\n{\n", nchunk);
+    for (p = a; p < b; p++) {
+      in = &Cfan[Cfin[p]];
+      n = Cfin[p + 1] - Cfin[p];
+      fprintf(fo, "  W n%d = ", p);
+      if (Ctype[p] == IPT) fprintf(fo, "V(%d)", p);
+      else if (n == 1 && Ctype[p] != XOR && Ctype[p] != OR && Ctype[p] != AND) {
+        /* BRCH, NOT and single-input NOR/NAND */
+        fprintf(fo, Ctype[p] == BRCH ? "" : "~");
+        if (in[0] >= a) fprintf(fo, "n%u", in[0]);
+        else fprintf(fo, "V(%u)", in[0]);
+      }
+      else {
+        if (Ctype[p] == NOR || Ctype[p] == NAND) fprintf(fo, "~(");
+        for (i = 0; i < n; i++) {
+          fprintf(fo, "%s", i ? op[Ctype[p]] : "");
+          if (in[i] >= a) fprintf(fo, "n%u", in[i]);
+          else fprintf(fo, "V(%u)", in[i]);
+        }
+        if (Ctype[p] == NOR || Ctype[p] == NAND) fprintf(fo, ")");
+      }
+      fprintf(fo, ";\n");
+    }
+    /* stores last: no load of the chunk has to be ordered against them */
+    for (p = a; p < b; p++) {
+      for (j = Cfout[p]; j < Cfout[p + 1] && Cdfan[j] < b; j++);
+      if ((j < Cfout[p + 1] || po[p]) && Ctype[p] != IPT)
+        fprintf(fo, "  V(%d) = n%d;\n", p, p);
+    }
+    fprintf(fo, "}\n");
+  }
+  fprintf(fo, "\nvoid fsim_eval(uint64_t *v, int nw)\n{\n");
+  for (i = 0; i < nchunk; i++) fprintf(fo, "  chunk%d(v);\n", i);
+  fprintf(fo, "}\n");
+  free(po);
+  return fclose(fo) == 0;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: 1 if Csimfn is ready
+called by: csim
+description:
+  Find or build the compiled simulator of the current netlist. Objects
+  are cached next to the circuit as <circuit>.<netlist hash>.so, so a
+  circuit is compiled once and later runs only dlopen it. On a miss the
+  C source is emitted and compiled with $CC (cc by default) into a
+  temporary file that is renamed into place. The compiler runs under
+  sh -c so that $CC may carry options, but the file names reach the
+  shell as positional arguments, never as command text, so no circuit
+  name can inject a command.
+-----------------------------------------------------------------------*/
+int csim_load()
+{
+  char base[MAXLINE + 4], src[2 * MAXLINE], so[2 * MAXLINE], tmp[2 * MAXLINE + 4], cmd[128];
+  pid_t pid;
+  int n, st;
+
+  if (Csimfn) return 1;
+  n = strlen(Cachename) - 4;                  /* drop ".fsc" */
+  sprintf(base, "%s%.*s", strchr(Cachename, '/') ? "" : "./", n, Cachename);
+  sprintf(so, "%s.%016llx.so", base, (unsigned long long) netlist_hash());
+  if (access(so, R_OK) != 0) {
+    sprintf(src, "%s.%016llx.c", base, (unsigned long long) netlist_hash());
+    if (!csim_emit(src)) return 0;
+    sprintf(tmp, "%s.tmp", so);
+    sprintf(cmd, "${CC:-cc} -O1 %s-shared -fPIC -o \"$1\" \"$2\"", PWORDS > 1 ? "-mavx2 " : "");
+    fflush(stdout);
+    if ((pid = fork()) == 0) {
+      execl("/bin/sh", "sh", "-c", cmd, "sh", tmp, src, (char *) NULL);
+      _exit(127);
+    }
+    if (pid < 0 || waitpid(pid, &st, 0) < 0 || !WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+      printf("Cannot compile %s!\n", src);
+      return 0;
+    }
+    unlink(src);
+    rename(tmp, so);
+    if (Verbose >= 1) printf("==> compiled simulator %s\n", so);
+  }
+  if ((Csimlib = dlopen(so, RTLD_NOW)) == NULL) {
+    printf("Cannot load %s: %s\n", so, dlerror());
+    return 0;
+  }
+  if ((Csimfn = (void (*)(uint64_t *, int)) dlsym(Csimlib, "fsim_eval")) == NULL) {
+    printf("Cannot load %s: %s\n", so, dlerror());
+    dlclose(Csimlib);
+    Csimlib = NULL;
+    return 0;
+  }
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: pattern file name, optional response file name
+output: nothing
+called by: main
+description:
+  Compiled-code fault free simulation: PSIM with parallel_sim replaced
+  by the straight-line function of csim_load, which has no gate type
+  dispatch and keeps node values in registers where it can.
+-----------------------------------------------------------------------*/
+int csim(cp)
+char *cp;
+{
+  if (!csim_load()) return 0;
+  return sim_patterns(cp, Csimfn, "CSIM");
+}
+
+/* cost of holding input u of a gate at its non-controlling value */
+#define SIDE(type, u) \
+  ((type) == AND || (type) == NAND ? Cc1[u] : (type) == OR || (type) == NOR ? Cc0[u] : \
+   (type) == XOR ? MIN(Cc0[u], Cc1[u]) : 0)
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: nothing
+called by: lev
+description:
+  SCOAP testability measures of every position. Cc0/Cc1 are the
+  combinational 0/1-controllabilities, computed in level order from
+  1 at the primary inputs; Co is the combinational observability,
+  computed in reverse level order from 0 at the primary outputs. A
+  fanout stem is as observable as its most observable branch. Each
+  pass visits every fanin edge once: the side-input cost of an input
+  is the gate's total minus its own term. Values saturate at SCOAPMAX
+  so that sums over wide cones cannot overflow. The measures are saved
+  in the netlist cache with the schedule.
+-----------------------------------------------------------------------*/
+void scoap()
+{
+  uint32_t *in;
+  int i, p, q, n, c0, c1, t0, t1, o;
+  long long s, t;
+
+  if (Cc0 == NULL) {
+    Cc0 = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+    Cc1 = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+    Co = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+  }
+  for (p = 0; p < Nnodes; p++) {
+    in = &Cfan[Cfin[p]];
+    n = Cfin[p + 1] - Cfin[p];
+    switch (Ctype[p]) {
+      case IPT:
+        c0 = c1 = 1;
+        break;
+      case BRCH:
+        c0 = Cc0[in[0]];
+        c1 = Cc1[in[0]];
+        break;
+      case NOT:
+        c0 = Cc1[in[0]] + 1;
+        c1 = Cc0[in[0]] + 1;
+        break;
+      case XOR:
+        c0 = Cc0[in[0]];
+        c1 = Cc1[in[0]];
+        for (i = 1; i < n; i++) {
+          t0 = MIN(c0 + Cc0[in[i]], c1 + Cc1[in[i]]);
+          t1 = MIN(c0 + Cc1[in[i]], c1 + Cc0[in[i]]);
+          c0 = MIN(t0, SCOAPMAX);
+          c1 = MIN(t1, SCOAPMAX);
+        }
+        c0++;
+        c1++;
+        break;
+      case AND:
+      case NAND:
+        for (i = 0, c0 = SCOAPMAX, c1 = 0; i < n; i++) {
+          c0 = MIN(c0, Cc0[in[i]]);
+          c1 = MIN(c1 + Cc1[in[i]], SCOAPMAX);
+        }
+        c0++;
+        c1++;
+        if (Ctype[p] == NAND) { t0 = c0; c0 = c1; c1 = t0; }
+        break;
+      default:                                   /* OR, NOR */
+        for (i = 0, c0 = 0, c1 = SCOAPMAX; i < n; i++) {
+          c0 = MIN(c0 + Cc0[in[i]], SCOAPMAX);
+          c1 = MIN(c1, Cc1[in[i]]);
+        }
+        c0++;
+        c1++;
+        if (Ctype[p] == NOR) { t0 = c0; c0 = c1; c1 = t0; }
+        break;
+    }
+    Cc0[p] = MIN(c0, SCOAPMAX);
+    Cc1[p] = MIN(c1, SCOAPMAX);
+  }
+
+  for (p = 0; p < Nnodes; p++) Co[p] = SCOAPMAX;
+  for (i = 0; i < Npo; i++) Co[Cpo[i]] = 0;
+  for (q = Nnodes - 1; q >= 0; q--) {
+    in = &Cfan[Cfin[q]];
+    n = Cfin[q + 1] - Cfin[q];
+    /* observability of input i through gate q: q observed, the other
+       inputs non-controlling */
+    for (i = 0, t = 0; i < n; i++) t += SIDE(Ctype[q], in[i]);
+    for (i = 0; i < n; i++) {
+      s = Co[q] + t - SIDE(Ctype[q], in[i]) + (Ctype[q] != BRCH);
+      o = MIN(s, SCOAPMAX);
+      if (o < Co[in[i]]) Co[in[i]] = o;
+    }
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: fault id
+output: SCOAP cost of detecting the fault
+called by: testability, fault_cmp
+description:
+  Controllability of the value opposite to the stuck value at the site
+  plus its observability: a fault is only found by patterns that
+  excite it and carry it to an output, so a high cost marks a fault
+  that random patterns are unlikely to detect.
+-----------------------------------------------------------------------*/
+int fault_cost(int fid)
+{
+  int p = Cpos[fid >> 1];
+
+  return MIN((fid & 1 ? Cc0[p] : Cc1[p]) + Co[p], SCOAPMAX);
+}
+
+int fault_cmp(const void *a, const void *b)
+{
+  int fa = *(const int *) a, fb = *(const int *) b;
+  int ca = fault_cost(fa), cb = fault_cost(fb);
+
+  if (ca != cb) return (ca > cb) ? -1 : 1;       /* hardest first */
+  return fa - fb;
+}
+
+/*-----------------------------------------------------------------------
+input: optional number of faults to list, optional fault order
+output: 1
+called by: main
+description:
+  Report the SCOAP measures computed by LEV: range and mean of CC0, CC1
+  and CO, the nodes no output can observe, and the target faults (all
+  faults before GFL) with the highest detection cost, which are the
+  random-pattern-resistant ones. "hard" or "easy" makes every later
+  command take the target faults hardest or easiest first; "none"
+  restores the fault list order.
+-----------------------------------------------------------------------*/
+int testability(cp)
+char *cp;
+{
+  char arg[2][MAXLINE];
+  int i, n, p, f, nf, count, nunobs, *fl;
+  int max0, max1, maxo;
+  double sum0, sum1, sumo;
+
+  count = 10;
+  n = sscanf(cp, "%s %s", arg[0], arg[1]);
+  for (i = 0; i < n; i++) {
+    if (isdigit(arg[i][0])) count = atoi(arg[i]);
+    else if (strcmp(arg[i], "hard") == 0) Forder = 1;
+    else if (strcmp(arg[i], "easy") == 0) Forder = -1;
+    else if (strcmp(arg[i], "none") == 0) Forder = 0;
+    else {
+      printf("Usage: SCOAP [nfaults] [hard|easy|none]\n");
+      return 0;
+    }
+  }
+
+  max0 = max1 = maxo = nunobs = 0;
+  sum0 = sum1 = sumo = 0;
+  for (p = 0; p < Nnodes; p++) {
+    max0 = (Cc0[p] > max0) ? Cc0[p] : max0;
+    max1 = (Cc1[p] > max1) ? Cc1[p] : max1;
+    sum0 += Cc0[p];
+    sum1 += Cc1[p];
+    if (Co[p] >= SCOAPMAX) nunobs++;
+    else {
+      maxo = (Co[p] > maxo) ? Co[p] : maxo;
+      sumo += Co[p];
+    }
+  }
+  printf("==> SCOAP of %d nodes\n", Nnodes);
+  printf("    CC0 max %d mean %.1f, CC1 max %d mean %.1f\n",
+         max0, Nnodes ? sum0 / Nnodes : 0.0, max1, Nnodes ? sum1 / Nnodes : 0.0);
+  printf("    CO max %d mean %.1f, %d unobservable nodes\n",
+         maxo, (Nnodes > nunobs) ? sumo / (Nnodes - nunobs) : 0.0, nunobs);
+
+  if (CompleteFL != NULL) {
+    nf = build_target_faults();
+    fl = (int *) arena_alloc(&Runarena, nf * sizeof(int));
+    memcpy(fl, Flist, nf * sizeof(int));
+  }
+  else {
+    nf = 2 * Nnodes;
+    fl = (int *) arena_alloc(&Runarena, nf * sizeof(int));
+    for (f = 0; f < nf; f++) fl[f] = f;
+  }
+  qsort(fl, nf, sizeof(int), fault_cmp);
+  if (count > nf) count = nf;
+  if (count > 0) printf("    %d hardest of %d faults (CC0 CC1 CO cost):\n", count, nf);
+  for (f = 0; f < count; f++) {
+    p = Cpos[fl[f] >> 1];
+    printf("\tNode %d s-a-%d: %d %d %d %d%s\n", Node[fl[f] >> 1].num, fl[f] & 1,
+           Cc0[p], Cc1[p], Co[p], fault_cost(fl[f]),
+           (fault_cost(fl[f]) >= SCOAPMAX) ? " (unobservable)" : "");
+  }
+  if (Forder) printf("    target faults are taken %s first\n", (Forder > 0) ? "hardest" : "easiest");
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: position, one machine of the PODEM values
+output: three-valued value of the node: 0, 1 or X
+called by: podem_imply
+description:
+  Evaluate one gate in 0/1/X logic. A controlling input decides an
+  AND/NAND/OR/NOR regardless of X on the other inputs.
+-----------------------------------------------------------------------*/
+int eval3(int p, uint8_t *a)
+{
+  uint32_t *in;
+  int i, n, v, x, c;
+
+  in = &Cfan[Cfin[p]];
+  n = Cfin[p + 1] - Cfin[p];
+  switch (Ctype[p]) {
+    case IPT:
+      return a[p];
+    case BRCH:
+      return a[in[0]];
+    case NOT:
+      return a[in[0]] == LX ? LX : !a[in[0]];
+    case XOR:
+      for (i = v = 0; i < n; i++) {
+        if (a[in[i]] == LX) return LX;
+        v ^= a[in[i]];
+      }
+      return v;
+  }
+  c = (Ctype[p] == OR || Ctype[p] == NOR);       /* controlling value */
+  for (i = x = 0; i < n; i++) {
+    if (a[in[i]] == c) return c ^ (Ctype[p] == NAND || Ctype[p] == NOR);
+    if (a[in[i]] == LX) x = 1;
+  }
+  if (x) return LX;
+  return !c ^ (Ctype[p] == NAND || Ctype[p] == NOR);
+}
+
+/*-----------------------------------------------------------------------
+input: position whose value changed
+output: nothing
+called by: podem_assign, podem
+description:
+  Incremental implication. The fanouts of the changed node are queued in
+  level buckets and re-evaluated in level order in the good and the
+  faulty machine; a node is only propagated further when one of its two
+  values changed. The fault site keeps its stuck value in the faulty
+  machine while a fault is targeted.
+-----------------------------------------------------------------------*/
+void podem_imply(int p)
+{
+  int j, k, l, q, g, f, lmax;
+
+  lmax = Clevel[p];
+  for (j = Cfout[p]; j < Cfout[p + 1]; j++) {
+    q = Cdfan[j];
+    if (Ainq[q]) continue;
+    Ainq[q] = 1;
+    Aqueue[Loffset[Clevel[q]] + Aqn[Clevel[q]]++] = q;
+    if (Clevel[q] > lmax) lmax = Clevel[q];
+  }
+  for (l = Clevel[p] + 1; l <= lmax; l++) {
+    for (k = 0; k < Aqn[l]; k++) {
+      q = Aqueue[Loffset[l] + k];
+      Ainq[q] = 0;
+      g = eval3(q, Ag);
+      f = (q == Asite) ? Asa : eval3(q, Af);
+      if (g == Ag[q] && f == Af[q]) continue;
+      Ag[q] = g;
+      Af[q] = f;
+      for (j = Cfout[q]; j < Cfout[q + 1]; j++) {
+        p = Cdfan[j];
+        if (Ainq[p]) continue;
+        Ainq[p] = 1;
+        Aqueue[Loffset[Clevel[p]] + Aqn[Clevel[p]]++] = p;
+        if (Clevel[p] > lmax) lmax = Clevel[p];
+      }
+    }
+    Aqn[l] = 0;
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: primary input position, value 0, 1 or X
+output: nothing
+called by: podem
+description:
+  Set a primary input in both machines and imply the change.
+-----------------------------------------------------------------------*/
+void podem_assign(int p, int v)
+{
+  Ag[p] = v;
+  Af[p] = (p == Asite) ? Asa : v;
+  podem_imply(p);
+}
+
+/*-----------------------------------------------------------------------
+input: objective position and value
+output: primary input position to assign, its value in *v; -1 if the
+        objective cannot be traced to an unassigned input
+called by: podem
+description:
+  Trace an objective back to a primary input through X lines of the
+  good machine. Inversions flip the value. When one input at the
+  controlling value sets the gate, the easiest such input by SCOAP is
+  followed; when every input must be non-controlling, the hardest one
+  is followed, so that a conflict shows up early.
+-----------------------------------------------------------------------*/
+int podem_backtrace(int p, int *v)
+{
+  uint32_t *in;
+  int i, n, c, u, best, cost, k;
+
+  while (Ctype[p] != IPT) {
+    in = &Cfan[Cfin[p]];
+    n = Cfin[p + 1] - Cfin[p];
+    if (Ctype[p] == NOT || Ctype[p] == NAND || Ctype[p] == NOR) *v = !*v;
+    best = -1;
+    if (Ctype[p] == BRCH || Ctype[p] == NOT) best = in[0];
+    else if (Ctype[p] == XOR) {
+      for (i = k = 0, cost = SCOAPMAX + 1; i < n; i++) {
+        u = in[i];
+        if (Ag[u] != LX) { k ^= Ag[u]; continue; }
+        if (MIN(Cc0[u], Cc1[u]) < cost) { cost = MIN(Cc0[u], Cc1[u]); best = u; }
+      }
+      *v ^= k;
+    }
+    else {
+      c = (Ctype[p] == OR || Ctype[p] == NOR);
+      for (i = 0, cost = -1; i < n; i++) {
+        u = in[i];
+        if (Ag[u] != LX) continue;
+        k = (*v ? Cc1[u] : Cc0[u]);
+        if (*v == c) k = SCOAPMAX - k;             /* easiest first */
+        if (k > cost) { cost = k; best = u; }
+      }
+    }
+    if (best < 0 || Ag[best] != LX) return -1;
+    p = best;
+  }
+  return (Ag[p] == LX) ? p : -1;
+}
+
+/*-----------------------------------------------------------------------
+input: fault id, backtrack limit
+output: FS_DET if a test was found (left in Ag), FS_RED if the fault
+        is untestable, FS_ABORT if the backtrack limit was hit
+called by: atpg
+description:
+  PODEM over the level-ordered netlist in five-valued logic: every line
+  carries a good and a faulty 0/1/X value, D being good 1 / faulty 0.
+  Decisions are made on primary inputs only; those below Abase belong
+  to tests of earlier faults and are never flipped, so with Abase > 0
+  FS_RED only means the fault does not fit the partial test. Each step
+  picks an objective, activating the fault first and then advancing the
+  D-frontier gate with the best SCOAP observability, backtraces it to a
+  primary input and implies the assignment incrementally. When the
+  fault can no longer be activated, or no D-frontier gate has an X-path
+  to a primary output, the most recent untried decision is flipped.
+  The primary inputs are left assigned; podem_reset clears them.
+-----------------------------------------------------------------------*/
+int podem(int fid, int limit)
+{
+  uint32_t *in;
+  int i, j, k, p, q, v, n, head, ncone, best, obj, objv, bad, front;
+
+  /* fanout cone of the fault site, in breadth-first discovery order */
+  Asite = Cpos[fid >> 1];
+  Asa = fid & 1;
+  Amark++;
+  Acone[0] = Asite;
+  Astamp[Asite] = Amark;
+  for (head = 0, ncone = 1; head < ncone; head++) {
+    p = Acone[head];
+    for (j = Cfout[p]; j < Cfout[p + 1]; j++)
+      if (Astamp[Cdfan[j]] != Amark) {
+        Astamp[Cdfan[j]] = Amark;
+        Acone[ncone++] = Cdfan[j];
+      }
+  }
+  Af[Asite] = Asa;
+  podem_imply(Asite);
+  Ansp = Abase;
+  Anbt = 0;
+
+  while (1) {
+    /* detected? */
+    for (i = 0; i < ncone; i++) {
+      p = Acone[i];
+      if (Pomark[p] && Ag[p] != LX && Af[p] != LX && Ag[p] != Af[p]) return FS_DET;
+    }
+
+    /* next objective */
+    obj = -1;
+    bad = (Ag[Asite] == Asa);
+    if (!bad && Ag[Asite] == LX) {
+      obj = Asite;
+      objv = !Asa;
+    }
+    else if (!bad) {
+      best = -1;
+      front = 0;
+      for (i = 1; i < ncone; i++) {              /* D-frontier */
+        q = Acone[i];
+        if (Ag[q] != LX && Af[q] != LX) continue;
+        in = &Cfan[Cfin[q]];
+        n = Cfin[q + 1] - Cfin[q];
+        for (k = 0; k < n; k++)
+          if (Ag[in[k]] != LX && Af[in[k]] != LX && Ag[in[k]] != Af[in[k]]) break;
+        if (k == n) continue;
+        Axq[front++] = q;
+        for (k = 0; k < n && Ag[in[k]] != LX; k++);
+        if (k == n) continue;                    /* X only in the faulty machine */
+        if (best < 0 || Co[q] < Co[best]) best = q;
+      }
+      if (!podem_xpath(front)) bad = 1;
+      else if (best >= 0) {
+        in = &Cfan[Cfin[best]];
+        n = Cfin[best + 1] - Cfin[best];
+        for (k = 0; k < n && Ag[in[k]] != LX; k++);
+        obj = in[k];
+        objv = !(Ctype[best] == OR || Ctype[best] == NOR);   /* non-controlling */
+        if (Ctype[best] == XOR) objv = 0;
+      }
+    }
+    if (!bad) {
+      v = objv;
+      p = (obj >= 0) ? podem_backtrace(obj, &v) : -1;
+      if (p < 0)                                 /* fall back to any free input */
+        for (i = 0, v = 0; i < Npi && p < 0; i++)
+          if (Ag[Cpi[i]] == LX) p = Cpi[i];
+      if (p < 0) bad = 1;
+      else {
+        Astack[Ansp++] = 2 * p + v;
+        TRACE(Asite, fid, "podem: %d/%d decide input %d = %d\n", Node[fid >> 1].num, Asa,
+              Node[Lorder[p]].num, v);
+        podem_assign(p, v);
+        continue;
+      }
+    }
+
+    /* backtrack: flip the latest untried decision */
+    while (Ansp > Abase && (Astack[Ansp - 1] & FLIPPED)) {
+      p = (Astack[--Ansp] & ~FLIPPED) >> 1;
+      podem_assign(p, LX);
+    }
+    if (Ansp == Abase) return FS_RED;
+    if (++Anbt > limit) return FS_ABORT;
+    p = Astack[Ansp - 1] >> 1;
+    v = !(Astack[Ansp - 1] & 1);
+    Astack[Ansp - 1] = (2 * p + v) | FLIPPED;
+    TRACE(Asite, fid, "podem: %d/%d backtrack %d, input %d = %d\n", Node[fid >> 1].num, Asa,
+          Anbt, Node[Lorder[p]].num, v);
+    podem_assign(p, v);
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: number of D-frontier gates in Axq
+output: 1 if one of them reaches a primary output through lines that
+        are X in the good or the faulty machine
+called by: podem
+description:
+  X-path check. A D-frontier gate whose fanout cone is already decided
+  can never propagate the fault effect, so the search backtracks as
+  soon as no such path is left.
+-----------------------------------------------------------------------*/
+int podem_xpath(int n)
+{
+  int i, j, p, q;
+
+  if (++Axmark == 0) {
+    memset(Axstamp, 0, Nnodes * sizeof(int));
+    Axmark = 1;
+  }
+  for (i = 0; i < n; i++) Axstamp[Axq[i]] = Axmark;
+  for (i = 0; i < n; i++) {
+    p = Axq[i];
+    if (Pomark[p]) return 1;
+    for (j = Cfout[p]; j < Cfout[p + 1]; j++) {
+      q = Cdfan[j];
+      if (Axstamp[q] == Axmark || (Ag[q] != LX && Af[q] != LX)) continue;
+      Axstamp[q] = Axmark;
+      Axq[n++] = q;
+    }
+  }
+  return 0;
+}
+
+/*-----------------------------------------------------------------------
+input: decision stack depth to return to
+output: nothing
+called by: podem_reset, dynamic_compact
+description:
+  Undo the PODEM decisions above a stack depth.
+-----------------------------------------------------------------------*/
+void podem_undo(int base)
+{
+  int p;
+
+  while (Ansp > base) {
+    p = (Astack[--Ansp] & ~FLIPPED) >> 1;
+    podem_assign(p, LX);
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: nothing
+called by: podem_reset, dynamic_compact
+description:
+  Release the fault site of the last PODEM run: the faulty machine
+  follows the good one again under the inputs still assigned.
+-----------------------------------------------------------------------*/
+void podem_release()
+{
+  int p;
+
+  if ((p = Asite) < 0) return;
+  Asite = -1;
+  Af[p] = (Ctype[p] == IPT) ? Ag[p] : eval3(p, Af);
+  podem_imply(p);
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: nothing
+called by: atpg
+description:
+  Undo the decisions of the last PODEM run and release the fault site,
+  leaving every line at X in both machines.
+-----------------------------------------------------------------------*/
+void podem_reset()
+{
+  Abase = 0;
+  podem_undo(0);
+  podem_release();
+}
+
+/*-----------------------------------------------------------------------
+input: fault the current PODEM test was generated for, live fault list
+output: number of further faults the test was extended to
+called by: atpg
+description:
+  Dynamic compaction. The inputs the test for fid assigned are frozen
+  (Abase) and PODEM targets up to COMPACTTRY other untried live faults
+  with the remaining inputs only, with a small backtrack limit. A
+  success keeps its decisions, frozen in turn; a failure undoes them.
+  The don't-care inputs of the test are thereby spent on detecting more
+  faults instead of being filled randomly. On return the PODEM state
+  holds the final test with every site released.
+-----------------------------------------------------------------------*/
+int dynamic_compact(int fid, int *live, int nlive)
+{
+  int i, n, nadd;
+
+  podem_release();
+  Abase = Ansp;
+  for (i = n = nadd = 0; i < nlive && n < COMPACTTRY && Abase < Npi; i++) {
+    if (live[i] == fid || Fstat[live[i]] != FS_UNDET) continue;
+    n++;
+    if (podem(live[i], COMPACTBT) == FS_DET) nadd++;
+    else podem_undo(Abase);
+    podem_release();
+    Abase = Ansp;
+  }
+  return nadd;
+}
+
+/*-----------------------------------------------------------------------
+input: output test file, optional backtrack limit, optional engine
+       (podem or sat; by default PODEM with SAT for the aborted faults)
+output: nothing
+called by: main
+description:
+  Deterministic test generation for the target fault list. Faults are
+  taken in list order and skipped once detected. PODEM generates a test
+  for each remaining fault and sat_atpg settles the faults PODEM gives
+  up on, or every fault in sat mode. With "random", random_phase first
+  drops the faults that random patterns find; "compact" extends every
+  PODEM test to more faults (dynamic_compact). Unassigned inputs are filled
+  randomly and the test is fault simulated against every live fault by
+  ppsfp_fault, which drops the target and whatever else it detects.
+  The tests are written one per line in the pattern file format, so
+  the output feeds directly into the fault simulators, and kept in
+  Tset, their cubes in Tcube. Fstat records the outcome of every fault.
+  Every run starts from the seed XSEED with a fresh SAT solver, so the
+  tests do not depend on the commands run before.
+-----------------------------------------------------------------------*/
+int atpg(cp)
+char *cp;
+{
+  char fout[MAXLINE], arg[6][MAXLINE], *pat, *cube;
+  FILE *fo;
+  PPSTRUC w;
+  uint64_t *good;
+  long nconf;
+  int i, f, n, fid, limit, mode, ndet, nred, nabort, nlive, *live;
+  int nsat, nsatdet, nsatred, rpg, rn, rk, nrpg, nrpgdet, nblock, dyn, ndyn;
+
+  limit = BTLIMIT;
+  mode = 0;                                      /* 0: PODEM then SAT, 1: PODEM, 2: SAT */
+  rpg = 0;
+  rn = RPGNEW;
+  rk = RPGWINDOW;
+  dyn = 0;
+  n = sscanf(cp, "%s %s %s %s %s %s %s", fout, arg[0], arg[1], arg[2], arg[3], arg[4], arg[5]);
+  for (i = 0; i + 1 < n; i++) {
+    if (isdigit(arg[i][0])) limit = atoi(arg[i]);
+    else if (strcmp(arg[i], "podem") == 0) mode = 1;
+    else if (strcmp(arg[i], "sat") == 0) mode = 2;
+    else if (strcmp(arg[i], "compact") == 0) dyn = 1;
+    else if (strcmp(arg[i], "random") == 0) {
+      rpg = 1;
+      if (i + 2 < n && isdigit(arg[i + 1][0])) rn = atoi(arg[++i]);
+      if (i + 2 < n && isdigit(arg[i + 1][0])) rk = atoi(arg[++i]);
+    }
+    else n = 0;
+  }
+  if (n < 1 || rk < 1) {
+    printf("Usage: ATPG testfile [backtrack_limit] [podem|sat] [random [N K]] [compact]\n");
+    return 0;
+  }
+  if (build_target_faults() < 0) return 0;
+  if ((fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    return 0;
+  }
+  Xstate = XSEED;                      /* same tests whatever ran before */
+  sat_free();
+  atpg_init();
+  ppsfp_init(&w);
+  good = (uint64_t *) arena_zalloc(&Runarena, Nnodes * sizeof(uint64_t));
+  pat = arena_alloc(&Runarena, Npi + 1);
+  pat[Npi] = '\0';
+  cube = arena_alloc(&Runarena, Npi + 1);
+  live = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+  memcpy(live, Flist, Nflist * sizeof(int));
+  nlive = Nflist;
+  Ntset = ndet = nred = nabort = ndyn = 0;
+  nsat = nsatdet = nsatred = 0;
+  nconf = Sat.nconflicts;
+  nrpg = nrpgdet = nblock = 0;
+  if (rpg) {
+    nrpgdet = random_phase(&w, good, live, &nlive, rn, rk, fo, pat, &nblock);
+    nrpg = Ntset;
+    ndet += nrpgdet;
+  }
+
+  for (f = 0; f < Nflist; f++) {
+    fid = Flist[f];
+    if (Fstat[fid] == FS_DET) continue;
+    if (mode != 2) {
+      Fstat[fid] = podem(fid, limit);
+      Stats.targets++;
+      Stats.backtracks += Anbt;
+      if (Anbt > Stats.maxbt) Stats.maxbt = Anbt;
+      Stats.bthist[MIN(Anbt ? 64 - __builtin_clzll(Anbt) : 0, BTBUCKETS - 1)]++;
+      if (Fstat[fid] == FS_DET) {
+        if (dyn) ndyn += dynamic_compact(fid, live, nlive);
+        for (i = 0; i < Npi; i++) {
+          cube[i] = (Ag[Cpi[i]] == LX) ? 'X' : '0' + Ag[Cpi[i]];
+          pat[i] = (Ag[Cpi[i]] == LX) ? '0' + (xrand() & 1) : cube[i];
+        }
+      }
+      podem_reset();
+    }
+    if (mode == 2 || (mode == 0 && Fstat[fid] == FS_ABORT)) {
+      Fstat[fid] = sat_atpg(fid, SATLIMIT, pat);
+      memcpy(cube, pat, Npi);
+      nsat++;
+      nsatdet += (Fstat[fid] == FS_DET);
+      nsatred += (Fstat[fid] == FS_RED);
+    }
+    if (Fstat[fid] != FS_DET) continue;
+
+    /* drop everything the new test detects */
+    fprintf(fo, "%s\n", pat);
+    tset_add(pat, cube);
+    pack_pattern(pat, 0, good, 1);
+    parallel_sim(good, 1);
+    for (i = n = 0; i < nlive; i++) {
+      if (ppsfp_fault(&w, live[i], good, 1, 0)) {
+        Fstat[live[i]] = FS_DET;
+        ndet++;
+      }
+      else live[n++] = live[i];
+    }
+    stats_drop(nlive - n);
+    nlive = n;
+  }
+
+  for (f = 0; f < Nflist; f++) {
+    nred += (Fstat[Flist[f]] == FS_RED);
+    nabort += (Fstat[Flist[f]] == FS_ABORT);
+  }
+  fclose(fo);
+  if (Verbose >= 1) {
+    printf("==> %d tests, %d detected, %d redundant, %d aborted of %d faults\n",
+           Ntset, ndet, nred, nabort, Nflist);
+    printf("    fault coverage %.2f%%, fault efficiency %.2f%%\n",
+           Nflist ? 100.0 * ndet / Nflist : 0.0,
+           Nflist ? 100.0 * (ndet + nred) / Nflist : 0.0);
+    if (rpg)
+      printf("    random: %d patterns, %d kept, %d faults detected (%.2f%%)\n",
+             64 * nblock, nrpg, nrpgdet, Nflist ? 100.0 * nrpgdet / Nflist : 0.0);
+    if (nsat > 0)
+      printf("    SAT: %d faults, %d tests, %d proven redundant, %ld conflicts\n",
+             nsat, nsatdet, nsatred, Sat.nconflicts - nconf);
+    if (dyn) printf("    dynamic compaction: %d more faults targeted by the tests\n", ndyn);
+  }
+  ppsfp_free(&w);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: nothing
+called by: atpg
+description:
+  Allocate the PODEM state for the current circuit on first use, from
+  Netarena: the good/faulty values (all X), the implication queue, the
+  cone, the decision stack and the fault status. Fault status is
+  cleared on every run.
+-----------------------------------------------------------------------*/
+void atpg_init()
+{
+  int i;
+
+  if (Ag == NULL) {
+    Ag = (uint8_t *) arena_alloc(&Netarena, Nnodes);
+    Af = (uint8_t *) arena_alloc(&Netarena, Nnodes);
+    memset(Ag, LX, Nnodes);
+    memset(Af, LX, Nnodes);
+    Ainq = (char *) arena_zalloc(&Netarena, Nnodes);
+    Aqueue = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+    Aqn = (int *) arena_zalloc(&Netarena, (Maxlevel + 1) * sizeof(int));
+    Acone = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+    Astamp = (int *) arena_zalloc(&Netarena, Nnodes * sizeof(int));
+    Astack = (int *) arena_alloc(&Netarena, (Npi + 1) * sizeof(int));
+    Axq = (int *) arena_alloc(&Netarena, Nnodes * sizeof(int));
+    Axstamp = (int *) arena_zalloc(&Netarena, Nnodes * sizeof(int));
+    Sfv = (int *) arena_alloc(&Netarena, 2 * Nnodes * sizeof(int));
+    Fstat = (char *) arena_alloc(&Netarena, 2 * Nnodes);
+    Amark = Axmark = 0;
+    Asite = -1;
+  }
+  if (Pomark == NULL) {
+    Pomark = arena_zalloc(&Netarena, Nnodes);
+    for (i = 0; i < Npo; i++) Pomark[Cpo[i]] = 1;
+  }
+  memset(Fstat, 0, 2 * Nnodes);
+}
+
+/*-----------------------------------------------------------------------
+input: PPSFP work buffers, good machine values, live fault list and its
+       size, stop criterion (fewer than rn new detections in the last rk
+       blocks), test file, pattern buffer
+output: number of faults detected; *nlive and *nblock are updated
+called by: atpg
+description:
+  Random pattern phase of ATPG. Every primary input gets a word of
+  xorshift bits, so a block is 64 random patterns, simulated with
+  parallel_sim and fault simulated against the live faults by
+  ppsfp_fault, which drops what they detect. Only the patterns that
+  are the first detection of some fault are kept as tests. The phase
+  ends when the detections of the last rk blocks add up to fewer than
+  rn, i.e. once random patterns stop paying off, or when no fault is
+  left.
+-----------------------------------------------------------------------*/
+int random_phase(PPSTRUC *w, uint64_t *good, int *live, int *nlive, int rn, int rk,
+                 FILE *fo, char *pat, int *nblock)
+{
+  uint64_t det, keep;
+  int i, b, n, k, ndet, win, *ring;
+
+  ring = (int *) arena_zalloc(&Runarena, rk * sizeof(int));
+  ndet = win = 0;
+  while (*nlive > 0) {
+    for (i = 0; i < Npi; i++) good[Cpi[i]] = xrand();
+    parallel_sim(good, 1);
+    keep = 0;
+    for (i = n = 0; i < *nlive; i++) {
+      if ((det = ppsfp_fault(w, live[i], good, ~0ULL, 0))) {
+        Fstat[live[i]] = FS_DET;
+        keep |= det & -det;                      /* first detecting pattern */
+      }
+      else live[n++] = live[i];
+    }
+    k = *nlive - n;
+    *nlive = n;
+    ndet += k;
+    stats_drop(k);
+    for (b = 0; b < 64; b++) {
+      if (!((keep >> b) & 1)) continue;
+      for (i = 0; i < Npi; i++) pat[i] = '0' + ((good[Cpi[i]] >> b) & 1);
+      fprintf(fo, "%s\n", pat);
+      tset_add(pat, pat);
+    }
+    win += k - ring[*nblock % rk];
+    ring[*nblock % rk] = k;
+    if (++*nblock >= rk && win < rn) break;
+  }
+  return ndet;
+}
+
+/*-----------------------------------------------------------------------
+input: test pattern, its test cube
+output: nothing
+called by: atpg, random_phase, compact
+description:
+  Append a test to the in-memory test set Tset, Npi characters a test,
+  and its cube (X on the inputs the test generator left free) to Tcube.
+-----------------------------------------------------------------------*/
+void tset_add(char *pat, char *cube)
+{
+  if (Ntset == Tcap) {
+    Tcap = Tcap ? 2 * Tcap : 64;
+    Tset = (char *) realloc(Tset, (size_t) Tcap * Npi);
+    Tcube = (char *) realloc(Tcube, (size_t) Tcap * Npi);
+  }
+  memcpy(&Tset[(size_t) Ntset * Npi], pat, Npi);
+  memcpy(&Tcube[(size_t) Ntset++ * Npi], cube, Npi);
+}
+
+/*-----------------------------------------------------------------------
+input: PPSFP work buffers, good machine values, n tests of Npi
+       characters, whether to simulate them last first, live fault list
+       and its size, flags per test
+output: number of faults detected; *nlive is updated
+called by: compact
+description:
+  Fault simulate a test set 64 tests at a time like PPSFP, dropping the
+  faults it detects. need[t] is set for every test t that detects a
+  fault not detected by the tests simulated before it.
+-----------------------------------------------------------------------*/
+int tset_sim(PPSTRUC *w, uint64_t *good, char *set, int n, int reverse,
+             int *live, int *nlive, char *need)
+{
+  uint64_t det, valid;
+  int i, j, k, b, m, ndet;
+
+  ndet = 0;
+  for (b = 0; b < n && *nlive > 0; b += 64) {
+    k = MIN(64, n - b);
+    for (j = 0; j < k; j++)
+      pack_pattern(&set[(size_t) (reverse ? n - 1 - b - j : b + j) * Npi], j, good, 1);
+    valid = (k == 64) ? ~0ULL : (1ULL << k) - 1;
+    parallel_sim(good, 1);
+    for (i = m = 0; i < *nlive; i++) {
+      if ((det = ppsfp_fault(w, live[i], good, valid, 0))) {
+        j = __builtin_ctzll(det);
+        need[reverse ? n - 1 - b - j : b + j] = 1;
+        ndet++;
+      }
+      else live[m++] = live[i];
+    }
+    stats_drop(*nlive - m);
+    *nlive = m;
+  }
+  return ndet;
+}
+
+/*-----------------------------------------------------------------------
+input: output test file
+output: 1 on success, 0 on error
+called by: main
+description:
+  Static compaction of the test set of the last ATPG run. First the
+  test cubes are merged: each cube joins the first merged cube it does
+  not conflict with, and the X left over are filled randomly. Then the
+  merged tests are fault simulated in reverse order and only those that
+  detect a fault no later test detects are kept, which drops the early
+  tests whose faults the later, more specific tests also catch. Faults
+  the original set detected but the compacted one does not (merging
+  changes the random fill) are covered again by adding back original
+  tests, and the combined set is pruned by a second reverse order
+  pass. The coverage before and after is measured with the PPSFP
+  engine and the result replaces Tset.
+-----------------------------------------------------------------------*/
+int compact(cp)
+char *cp;
+{
+  char fout[MAXLINE], *mcube, *mset, *need, *undet, *c, *m;
+  FILE *fo;
+  PPSTRUC w;
+  uint64_t *good;
+  struct timespec t0, t1;
+  int i, j, t, n, nm, nk, nlive, ndet0, ndet1, *live;
+
+  if (sscanf(cp, "%s", fout) != 1) {
+    printf("Usage: COMPACT testfile\n");
+    return 0;
+  }
+  if (Ntset == 0) {
+    printf("No test set, run ATPG first!\n");
+    return 0;
+  }
+  if (build_target_faults() < 0) return 0;
+  if ((fo = fopen(fout, "w")) == NULL) {
+    printf("Cannot open %s!\n", fout);
+    return 0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  Xstate = XSEED;
+  ppsfp_init(&w);
+  good = (uint64_t *) arena_zalloc(&Runarena, Nnodes * sizeof(uint64_t));
+  live = (int *) arena_alloc(&Runarena, Nflist * sizeof(int));
+  need = arena_zalloc(&Runarena, 2 * (size_t) Ntset);   /* nm + Ntset tests at most */
+  undet = arena_zalloc(&Runarena, 2 * Nnodes);
+
+  /* faults the original set detects */
+  memcpy(live, Flist, Nflist * sizeof(int));
+  nlive = Nflist;
+  ndet0 = tset_sim(&w, good, Tset, Ntset, 0, live, &nlive, need);
+  for (i = 0; i < nlive; i++) undet[live[i]] = 1;
+
+  /* merge compatible cubes, first fit */
+  mcube = arena_alloc(&Runarena, (size_t) Ntset * Npi);
+  for (t = nm = 0; t < Ntset; t++) {
+    c = &Tcube[(size_t) t * Npi];
+    for (j = 0; j < nm; j++) {
+      m = &mcube[(size_t) j * Npi];
+      for (i = 0; i < Npi; i++)
+        if (c[i] != 'X' && m[i] != 'X' && c[i] != m[i]) break;
+      if (i == Npi) break;
+    }
+    m = &mcube[(size_t) j * Npi];
+    if (j == nm) {
+      memcpy(m, c, Npi);
+      nm++;
+    }
+    else
+      for (i = 0; i < Npi; i++)
+        if (c[i] != 'X') m[i] = c[i];
+  }
+  mset = arena_alloc(&Runarena, (size_t) (nm + Ntset) * Npi);
+  for (j = 0; j < nm; j++)
+    for (i = 0; i < Npi; i++) {
+      c = &mcube[(size_t) j * Npi + i];
+      mset[(size_t) j * Npi + i] = (*c == 'X') ? '0' + (xrand() & 1) : *c;
+    }
+
+  /* reverse order fault simulation of the merged tests */
+  memcpy(live, Flist, Nflist * sizeof(int));
+  nlive = Nflist;
+  memset(need, 0, 2 * (size_t) Ntset);
+  tset_sim(&w, good, mset, nm, 1, live, &nlive, need);
+  for (j = nk = 0; j < nm; j++)
+    if (need[j]) memmove(&mset[(size_t) nk++ * Npi], &mset[(size_t) j * Npi], Npi);
+
+  /* faults lost by the merge: add back original tests for them */
+  for (i = n = 0; i < nlive; i++)
+    if (!undet[live[i]]) live[n++] = live[i];
+  if (n > 0) {
+    memset(need, 0, 2 * (size_t) Ntset);
+    tset_sim(&w, good, Tset, Ntset, 0, live, &n, need);
+    for (t = 0; t < Ntset; t++)
+      if (need[t]) memcpy(&mset[(size_t) nk++ * Npi], &Tset[(size_t) t * Npi], Npi);
+
+    /* and prune the combined set once more */
+    memcpy(live, Flist, Nflist * sizeof(int));
+    nlive = Nflist;
+    memset(need, 0, 2 * (size_t) Ntset);
+    tset_sim(&w, good, mset, nk, 1, live, &nlive, need);
+    for (j = n = 0; j < nk; j++)
+      if (need[j]) memmove(&mset[(size_t) n++ * Npi], &mset[(size_t) j * Npi], Npi);
+    nk = n;
+  }
+
+  /* coverage of the compacted set */
+  memcpy(live, Flist, Nflist * sizeof(int));
+  nlive = Nflist;
+  ndet1 = tset_sim(&w, good, mset, nk, 0, live, &nlive, need);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  n = Ntset;
+  Ntset = 0;
+  for (t = 0; t < nk; t++) {
+    c = &mset[(size_t) t * Npi];
+    fprintf(fo, "%.*s\n", Npi, c);
+    tset_add(c, c);
+  }
+  fclose(fo);
+  if (Verbose >= 1) {
+    printf("==> %d tests, %d after merging cubes, %d after reverse order simulation (%.1f%% fewer)\n",
+           n, nm, nk, n ? 100.0 * (n - nk) / n : 0.0);
+    printf("    fault coverage %.2f%% before, %.2f%% after, %.3f s\n",
+           Nflist ? 100.0 * ndet0 / Nflist : 0.0, Nflist ? 100.0 * ndet1 / Nflist : 0.0,
+           (t1.tv_sec - t0.tv_sec) + 1e-9 * (t1.tv_nsec - t0.tv_nsec));
+  }
+  ppsfp_free(&w);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: next pseudo random number
+called by: atpg, random_phase, compact, gen, bench_patterns
+description:
+  xorshift64 generator. ATPG and COMPACT start from the seed XSEED, so
+  their results do not depend on the commands run before them.
+-----------------------------------------------------------------------*/
+uint64_t xrand()
+{
+  Xstate ^= Xstate << 13;
+  Xstate ^= Xstate >> 7;
+  Xstate ^= Xstate << 17;
+  return Xstate;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: nothing
+called by: sat_init
+description:
+  Release the SAT solver.
+-----------------------------------------------------------------------*/
+void sat_free()
+{
+  int i;
+
+  for (i = 0; i < 2 * Sat.cap; i++) free(Sat.watch[i].w);
+  free(Sat.watch);
+  free(Sat.cdb);
+  free(Sat.val);
+  free(Sat.level);
+  free(Sat.reason);
+  free(Sat.act);
+  free(Sat.phase);
+  free(Sat.seen);
+  free(Sat.trail);
+  free(Sat.lim);
+  free(Sat.heap);
+  free(Sat.hpos);
+  free(Sat.learnt);
+  memset(&Sat, 0, sizeof(Sat));
+}
+
+/*-----------------------------------------------------------------------
+input: number of variables
+output: first of the new variables
+called by: sat_init, sat_atpg
+description:
+  Add n variables to the solver, growing the per-variable arrays and the
+  watch lists geometrically. New variables go into the decision heap.
+-----------------------------------------------------------------------*/
+int sat_newvars(int n)
+{
+  int v, cap;
+
+  if (Sat.nvars + n > Sat.cap) {
+    cap = Sat.cap;
+    Sat.cap = 2 * (Sat.nvars + n);
+    Sat.watch = (WATCH *) realloc(Sat.watch, 2 * Sat.cap * sizeof(WATCH));
+    memset(&Sat.watch[2 * cap], 0, 2 * (Sat.cap - cap) * sizeof(WATCH));
+    Sat.val = (uint8_t *) realloc(Sat.val, Sat.cap);
+    Sat.level = (int *) realloc(Sat.level, Sat.cap * sizeof(int));
+    Sat.reason = (int *) realloc(Sat.reason, Sat.cap * sizeof(int));
+    Sat.act = (double *) realloc(Sat.act, Sat.cap * sizeof(double));
+    Sat.phase = (uint8_t *) realloc(Sat.phase, Sat.cap);
+    Sat.seen = (char *) realloc(Sat.seen, Sat.cap);
+    Sat.trail = (int *) realloc(Sat.trail, Sat.cap * sizeof(int));
+    Sat.lim = (int *) realloc(Sat.lim, (Sat.cap + 1) * sizeof(int));
+    Sat.heap = (int *) realloc(Sat.heap, Sat.cap * sizeof(int));
+    Sat.hpos = (int *) realloc(Sat.hpos, Sat.cap * sizeof(int));
+    Sat.learnt = (int *) realloc(Sat.learnt, (Sat.cap + 1) * sizeof(int));
+  }
+  for (v = Sat.nvars; v < Sat.nvars + n; v++) {
+    Sat.val[v] = LX;
+    Sat.level[v] = 0;
+    Sat.reason[v] = -1;
+    Sat.act[v] = 0;
+    Sat.phase[v] = 0;
+    Sat.seen[v] = 0;
+    Sat.hpos[v] = -1;
+    heap_insert(v);
+  }
+  Sat.nvars += n;
+  return Sat.nvars - n;
+}
+
+/*-----------------------------------------------------------------------
+input: variable
+output: nothing
+called by: sat_newvars, sat_backtrack, sat_bump
+description:
+  Binary max-heap of the unassigned variables keyed by VSIDS activity.
+  heap_insert adds a variable (or restores its place after a bump),
+  heap_pop removes the most active one.
+-----------------------------------------------------------------------*/
+void heap_insert(int v)
+{
+  int i, p;
+
+  if ((i = Sat.hpos[v]) < 0) i = Sat.nheap++;
+  while (i > 0 && Sat.act[Sat.heap[p = (i - 1) / 2]] < Sat.act[v]) {
+    Sat.heap[i] = Sat.heap[p];
+    Sat.hpos[Sat.heap[i]] = i;
+    i = p;
+  }
+  Sat.heap[i] = v;
+  Sat.hpos[v] = i;
+}
+
+int heap_pop()
+{
+  int v, x, i, c;
+
+  v = Sat.heap[0];
+  Sat.hpos[v] = -1;
+  x = Sat.heap[--Sat.nheap];
+  if (Sat.nheap == 0) return v;
+  for (i = 0; (c = 2 * i + 1) < Sat.nheap; i = c) {
+    if (c + 1 < Sat.nheap && Sat.act[Sat.heap[c + 1]] > Sat.act[Sat.heap[c]]) c++;
+    if (Sat.act[Sat.heap[c]] <= Sat.act[x]) break;
+    Sat.heap[i] = Sat.heap[c];
+    Sat.hpos[Sat.heap[i]] = i;
+  }
+  Sat.heap[i] = x;
+  Sat.hpos[x] = i;
+  return v;
+}
+
+/*-----------------------------------------------------------------------
+input: literal, reason clause (-1 for a decision)
+output: nothing
+called by: sat_addclause, sat_propagate, sat_solve
+description:
+  Make a literal true at the current decision level. Literals are
+  2 * variable + sign, so lit ^ 1 is the complement.
+-----------------------------------------------------------------------*/
+void sat_enqueue(int lit, int reason)
+{
+  int v = lit >> 1;
+
+  Sat.val[v] = !(lit & 1);
+  Sat.level[v] = Sat.nlevel;
+  Sat.reason[v] = reason;
+  Sat.trail[Sat.ntrail++] = lit;
+}
+
+#define LVAL(l) (Sat.val[(l) >> 1] == LX ? LX : Sat.val[(l) >> 1] ^ ((l) & 1))
+
+void sat_watch(int lit, int cr)
+{
+  WATCH *w = &Sat.watch[lit];
+
+  if (w->n == w->cap) {
+    w->cap = w->cap ? 2 * w->cap : 4;
+    w->w = (int *) realloc(w->w, w->cap * sizeof(int));
+  }
+  w->w[w->n++] = cr;
+}
+
+/*-----------------------------------------------------------------------
+input: literals, number of literals
+output: 0 if the clause makes the problem unsatisfiable, 1 otherwise
+called by: sat_gate, sat_atpg
+description:
+  Add a clause at decision level 0. Literals false at level 0 are left
+  out and satisfied clauses are skipped; a unit clause is asserted and
+  propagated. Clauses are stored in the flat array cdb as a size word
+  followed by the literals, the first two being watched.
+-----------------------------------------------------------------------*/
+int sat_addclause(int *lits, int n)
+{
+  int i, k, cr;
+
+  if (!Sat.ok) return 0;
+  for (i = k = 0; i < n; i++) {
+    if (LVAL(lits[i]) == 1) return 1;
+    if (LVAL(lits[i]) == 0) continue;
+    lits[k++] = lits[i];
+  }
+  if (k == 0) return Sat.ok = 0;
+  if (k == 1) {
+    sat_enqueue(lits[0], -1);
+    if (sat_propagate() >= 0) Sat.ok = 0;
+    return Sat.ok;
+  }
+  cr = sat_store(lits, k);
+  sat_watch(lits[0], cr);
+  sat_watch(lits[1], cr);
+  return 1;
+}
+
+int sat_store(int *lits, int n)
+{
+  int cr;
+
+  if (Sat.ncdb + n + 1 > Sat.cdbcap) {
+    Sat.cdbcap = 2 * (Sat.ncdb + n + 1);
+    Sat.cdb = (int *) realloc(Sat.cdb, Sat.cdbcap * sizeof(int));
+  }
+  cr = Sat.ncdb;
+  Sat.cdb[cr] = n;
+  memcpy(&Sat.cdb[cr + 1], lits, n * sizeof(int));
+  Sat.ncdb += n + 1;
+  return cr;
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: conflicting clause, -1 if none
+called by: sat_addclause, sat_solve
+description:
+  Unit propagation with two watched literals. For every literal made
+  false, each clause watching it looks for another non-false literal to
+  watch; if there is none the clause is unit (its other watch is
+  implied) or conflicting.
+-----------------------------------------------------------------------*/
+int sat_propagate()
+{
+  WATCH *ws;
+  int *c, i, j, k, n, t, cr, fl;
+
+  while (Sat.qhead < Sat.ntrail) {
+    fl = Sat.trail[Sat.qhead++] ^ 1;            /* literal that became false */
+    ws = &Sat.watch[fl];
+    for (i = j = 0; i < ws->n; i++) {
+      cr = ws->w[i];
+      c = &Sat.cdb[cr + 1];
+      n = Sat.cdb[cr];
+      if (c[0] == fl) { c[0] = c[1]; c[1] = fl; }
+      if (LVAL(c[0]) == 1) { ws->w[j++] = cr; continue; }
+      for (k = 2; k < n && LVAL(c[k]) == 0; k++);
+      if (k < n) {
+        t = c[1]; c[1] = c[k]; c[k] = t;
+        sat_watch(c[1], cr);                     /* c[1] != fl: ws is not touched */
+        continue;
+      }
+      ws->w[j++] = cr;
+      if (LVAL(c[0]) == 0) {
+        for (i++; i < ws->n; i++) ws->w[j++] = ws->w[i];
+        ws->n = j;
+        Sat.qhead = Sat.ntrail;
+        return cr;
+      }
+      sat_enqueue(c[0], cr);
+    }
+    ws->n = j;
+  }
+  return -1;
+}
+
+/*-----------------------------------------------------------------------
+input: variable
+output: nothing
+called by: sat_analyze
+description:
+  VSIDS: raise the activity of a variable seen in a conflict. The
+  increment grows after every conflict, which decays old activity.
+-----------------------------------------------------------------------*/
+void sat_bump(int v)
+{
+  int i;
+
+  if ((Sat.act[v] += Sat.inc) > 1e100) {
+    for (i = 0; i < Sat.nvars; i++) Sat.act[i] *= 1e-100;
+    Sat.inc *= 1e-100;
+  }
+  if (Sat.hpos[v] >= 0) heap_insert(v);
+}
+
+/*-----------------------------------------------------------------------
+input: conflicting clause
+output: size of the learnt clause in Sat.learnt, its backtrack level
+        in *blevel
+called by: sat_solve
+description:
+  First-UIP conflict analysis. Literals of the current level are
+  resolved away along the trail until one remains; its complement is
+  put first in the learnt clause and the literal of the highest other
+  level second, so the clause is asserting after the backjump.
+-----------------------------------------------------------------------*/
+int sat_analyze(int cr, int *blevel)
+{
+  int *c, i, j, n, v, p, idx, npath, nl;
+
+  nl = 1;
+  npath = 0;
+  p = -1;
+  idx = Sat.ntrail - 1;
+  do {
+    c = &Sat.cdb[cr + 1];
+    n = Sat.cdb[cr];
+    for (j = (p < 0) ? 0 : 1; j < n; j++) {
+      v = c[j] >> 1;
+      if (Sat.seen[v] || Sat.level[v] == 0) continue;
+      Sat.seen[v] = 1;
+      sat_bump(v);
+      if (Sat.level[v] == Sat.nlevel) npath++;
+      else Sat.learnt[nl++] = c[j];
+    }
+    while (!Sat.seen[Sat.trail[idx] >> 1]) idx--;
+    p = Sat.trail[idx--];
+    cr = Sat.reason[p >> 1];
+    Sat.seen[p >> 1] = 0;
+  } while (--npath > 0);
+  Sat.learnt[0] = p ^ 1;
+
+  *blevel = 0;
+  for (i = 1, j = 1; i < nl; i++) {
+    Sat.seen[Sat.learnt[i] >> 1] = 0;
+    if (Sat.level[Sat.learnt[i] >> 1] > *blevel) {
+      *blevel = Sat.level[Sat.learnt[i] >> 1];
+      j = i;
+    }
+  }
+  p = Sat.learnt[1]; Sat.learnt[1] = Sat.learnt[j]; Sat.learnt[j] = p;
+  Sat.inc *= 1.0 / 0.95;
+  return nl;
+}
+
+/*-----------------------------------------------------------------------
+input: decision level
+output: nothing
+called by: sat_solve
+description:
+  Undo the assignments above a decision level, saving their phases and
+  returning the variables to the decision heap.
+-----------------------------------------------------------------------*/
+void sat_backtrack(int level)
+{
+  int i, v;
+
+  if (Sat.nlevel <= level) return;
+  for (i = Sat.ntrail - 1; i >= Sat.lim[level]; i--) {
+    v = Sat.trail[i] >> 1;
+    Sat.phase[v] = Sat.val[v];
+    Sat.val[v] = LX;
+    if (Sat.hpos[v] < 0) heap_insert(v);
+  }
+  Sat.ntrail = Sat.qhead = Sat.lim[level];
+  Sat.nlevel = level;
+}
+
+/*-----------------------------------------------------------------------
+input: restart number
+output: length factor of the restart
+called by: sat_solve
+description:
+  Luby sequence 1 1 2 1 1 2 4 1 1 2 ...
+-----------------------------------------------------------------------*/
+int luby(int i)
+{
+  int size, seq;
+
+  for (size = 1, seq = 0; size < i + 1; seq++, size = 2 * size + 1);
+  while (size - 1 != i) {
+    size = (size - 1) >> 1;
+    seq--;
+    i = i % size;
+  }
+  return 1 << seq;
+}
+
+/*-----------------------------------------------------------------------
+input: assumption literals, number of assumptions, conflict limit
+output: 1 satisfiable (model in Sat.val), 0 unsatisfiable under the
+        assumptions, -1 conflict limit reached
+called by: sat_atpg
+description:
+  CDCL search: VSIDS decisions with phase saving, first-UIP learning
+  with non-chronological backjumping and Luby restarts. The assumptions
+  are decided first, one level each; a conflict that backjumps into
+  them proves the formula unsatisfiable under the assumptions. Learnt
+  clauses are kept and stay valid for later calls, since they only
+  ever mention the assumptions negatively.
+-----------------------------------------------------------------------*/
+int sat_solve(int *assume, int na, int limit)
+{
+  int cr, n, bl, v, lit, nconf, restart, budget;
+
+  if (!Sat.ok) return 0;
+  nconf = restart = 0;
+  budget = SATRESTART * luby(restart);
+  while (1) {
+    cr = sat_propagate();
+    if (cr >= 0) {
+      Sat.nconflicts++;
+      if (Sat.nlevel == 0) return Sat.ok = 0;
+      n = sat_analyze(cr, &bl);
+      sat_backtrack(bl);
+      if (n == 1) sat_enqueue(Sat.learnt[0], -1);
+      else {
+        cr = sat_store(Sat.learnt, n);
+        sat_watch(Sat.learnt[0], cr);
+        sat_watch(Sat.learnt[1], cr);
+        sat_enqueue(Sat.learnt[0], cr);
+      }
+      if (++nconf >= limit) {
+        sat_backtrack(0);
+        return -1;
+      }
+      if (--budget == 0) {                        /* restart */
+        sat_backtrack(0);
+        budget = SATRESTART * luby(++restart);
+      }
+      continue;
+    }
+
+    /* decide: assumptions first, then the most active variable */
+    lit = -1;
+    while (Sat.nlevel < na) {
+      lit = assume[Sat.nlevel];
+      if (LVAL(lit) == 0) {
+        sat_backtrack(0);
+        return 0;
+      }
+      Sat.lim[Sat.nlevel++] = Sat.ntrail;
+      if (LVAL(lit) == LX) break;
+      lit = -1;
+    }
+    if (lit < 0) {
+      do {
+        if (Sat.nheap == 0) return 1;            /* all assigned: model found */
+        v = heap_pop();
+      } while (Sat.val[v] != LX);
+      lit = 2 * v + !Sat.phase[v];
+      Sat.lim[Sat.nlevel++] = Sat.ntrail;
+    }
+    sat_enqueue(lit, -1);
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: gate type, output literal, input literals, number of inputs,
+       guard literal (-1 for a permanent gate)
+output: nothing
+called by: sat_init, sat_atpg
+description:
+  Tseitin encoding of one gate. Inverting gates are encoded as their
+  base gate with the output literal complemented; an XOR of more than
+  two inputs is chained through auxiliary variables. A guarded gate
+  gets the guard literal in every clause, so it is switched off once
+  the guard is asserted.
+-----------------------------------------------------------------------*/
+void sat_gate(int type, int o, int *in, int n, int g)
+{
+  int c[n + 4], i, k, a, b;
+
+  if (type == NAND || type == NOR || type == NOT) o ^= 1;
+  switch (type) {
+    case BRCH:
+    case NOT:
+      c[0] = o ^ 1; c[1] = in[0]; k = 2; if (g >= 0) c[k++] = g;
+      sat_addclause(c, k);
+      c[0] = o; c[1] = in[0] ^ 1; k = 2; if (g >= 0) c[k++] = g;
+      sat_addclause(c, k);
+      break;
+    case AND:
+    case NAND:
+    case OR:
+    case NOR:
+      a = (type == OR || type == NOR);           /* OR: complement everything */
+      for (i = 0; i < n; i++) {
+        c[0] = o ^ 1 ^ a; c[1] = in[i] ^ a; k = 2; if (g >= 0) c[k++] = g;
+        sat_addclause(c, k);
+      }
+      c[0] = o ^ a;
+      for (i = 0; i < n; i++) c[i + 1] = in[i] ^ 1 ^ a;
+      k = n + 1;
+      if (g >= 0) c[k++] = g;
+      sat_addclause(c, k);
+      break;
+    case XOR:
+      a = in[0];
+      for (i = 1; i < n; i++) {
+        b = (i == n - 1) ? o : 2 * sat_newvars(1);
+        c[0] = b ^ 1; c[1] = a; c[2] = in[i]; k = 3; if (g >= 0) c[k++] = g;
+        sat_addclause(c, k);
+        c[0] = b ^ 1; c[1] = a ^ 1; c[2] = in[i] ^ 1; k = 3; if (g >= 0) c[k++] = g;
+        sat_addclause(c, k);
+        c[0] = b; c[1] = a ^ 1; c[2] = in[i]; k = 3; if (g >= 0) c[k++] = g;
+        sat_addclause(c, k);
+        c[0] = b; c[1] = a; c[2] = in[i] ^ 1; k = 3; if (g >= 0) c[k++] = g;
+        sat_addclause(c, k);
+        a = b;
+      }
+      if (n == 1) {
+        sat_gate(BRCH, o, in, 1, g);
+      }
+      break;
+  }
+}
+
+/*-----------------------------------------------------------------------
+input: nothing
+output: nothing
+called by: sat_atpg
+description:
+  (Re)build the solver with the good circuit: variable p is the good
+  value of position p and every gate is a permanent Tseitin encoding.
+  Called on first use and whenever the per-fault variables and learnt
+  clauses have grown past the size of the circuit, which bounds memory
+  over a long fault list.
+-----------------------------------------------------------------------*/
+void sat_init()
+{
+  uint32_t *in;
+  int i, p, n, *u;
+  long nconflicts;
+
+  nconflicts = Sat.nconflicts;
+  sat_free();
+  Sat.nconflicts = nconflicts;
+  Sat.ok = 1;
+  Sat.inc = 1.0;
+  sat_newvars(Nnodes);
+  u = (int *) malloc((Cfin[Nnodes] + 1) * sizeof(int));
+  for (p = 0; p < Nnodes; p++) {
+    if (Ctype[p] == IPT) continue;
+    in = &Cfan[Cfin[p]];
+    n = Cfin[p + 1] - Cfin[p];
+    for (i = 0; i < n; i++) u[i] = 2 * in[i];
+    sat_gate(Ctype[p], 2 * p, u, n, -1);
+  }
+  free(u);
+  Sat.base = Sat.ncdb;
+}
+
+/*-----------------------------------------------------------------------
+input: fault id, conflict limit, pattern buffer
+output: FS_DET with the test in pat, FS_RED if the fault is proven
+        untestable, FS_ABORT if the conflict limit was reached
+called by: atpg
+description:
+  SAT-based test generation. The faulty copy of the fault's fanout cone
+  is added on fresh variables, fed by the good variables outside the
+  cone, with the fault site tied to its stuck value and the good site
+  to the opposite. Each cone node also gets a D variable meaning good
+  and faulty values differ there; the site has D and a D on a node that
+  is not a primary output needs a D on one of its fanouts, so a model
+  is a propagation path to an output. These path clauses are redundant
+  for satisfiability but prune most of the search for untestable
+  faults. All of the clauses are guarded by a fresh activation literal,
+  the problem is solved assuming it, and the guard is then asserted to
+  retire them. The good circuit and every learnt clause stay in the
+  solver, so faults with overlapping cones reuse what earlier calls
+  learnt.
+-----------------------------------------------------------------------*/
+int sat_atpg(int fid, int limit, char *pat)
+{
+  uint32_t *in;
+  int i, j, k, n, p, q, a, site, head, ncone, r, first, *fv, *dv;
+  int c[4], *u;
+  double hi;
+
+  if (!Sat.ok || Sat.nvars > 3 * Nnodes + SATSLACK || Sat.ncdb > 3 * Sat.base + SATSLACK)
+    sat_init();
+
+  /* fanout cone of the site */
+  site = Cpos[fid >> 1];
+  Amark++;
+  Acone[0] = site;
+  Astamp[site] = Amark;
+  for (head = 0, ncone = 1; head < ncone; head++) {
+    p = Acone[head];
+    for (j = Cfout[p]; j < Cfout[p + 1]; j++)
+      if (Astamp[Cdfan[j]] != Amark) {
+        Astamp[Cdfan[j]] = Amark;
+        Acone[ncone++] = Cdfan[j];
+      }
+  }
+
+  first = sat_newvars(1);
+  a = 2 * first;                                 /* activation: assume a */
+  fv = Sfv;
+  dv = Sfv + Nnodes;
+  u = (int *) malloc((Cfin[Nnodes] + Cfout[Nnodes] + 2) * sizeof(int));
+  for (i = 0; i < ncone; i++) {
+    fv[Acone[i]] = 2 * sat_newvars(1);
+    dv[Acone[i]] = 2 * sat_newvars(1);
+  }
+
+  c[0] = a ^ 1; c[1] = fv[site] ^ !(fid & 1);    /* faulty site = stuck value */
+  sat_addclause(c, 2);
+  c[0] = a ^ 1; c[1] = 2 * site ^ (fid & 1);     /* good site = opposite */
+  sat_addclause(c, 2);
+  c[0] = a ^ 1; c[1] = dv[site];                 /* the effect starts at the site */
+  sat_addclause(c, 2);
+  for (i = 0; i < ncone; i++) {
+    q = Acone[i];
+    if (q != site) {
+      in = &Cfan[Cfin[q]];
+      n = Cfin[q + 1] - Cfin[q];
+      for (k = 0; k < n; k++)
+        u[k] = (Astamp[in[k]] == Amark) ? fv[in[k]] : 2 * in[k];
+      sat_gate(Ctype[q], fv[q], u, n, a ^ 1);
+    }
+    c[0] = a ^ 1; c[1] = dv[q] ^ 1; c[2] = 2 * q; c[3] = fv[q];
+    sat_addclause(c, 4);                          /* d -> good != faulty */
+    c[0] = a ^ 1; c[1] = dv[q] ^ 1; c[2] = 2 * q ^ 1; c[3] = fv[q] ^ 1;
+    sat_addclause(c, 4);
+    if (!Pomark[q]) {                             /* d -> d on some fanout */
+      u[0] = a ^ 1; u[1] = dv[q] ^ 1;
+      for (k = 2, j = Cfout[q]; j < Cfout[q + 1]; j++) u[k++] = dv[Cdfan[j]];
+      sat_addclause(u, k);
+    }
+  }
+
+  /* start the search on this fault's variables and the good cone */
+  hi = Sat.nheap ? Sat.act[Sat.heap[0]] : 0;
+  for (q = first; q < Sat.nvars; q++) Sat.act[q] = hi;
+  for (i = 0; i < ncone; i++) {
+    Sat.act[Acone[i]] = hi;
+    if (Sat.hpos[Acone[i]] >= 0) heap_insert(Acone[i]);
+  }
+  for (q = first; q < Sat.nvars; q++) heap_insert(q);
+
+  r = sat_solve(&a, 1, limit);
+  if (r == 1)
+    for (i = 0; i < Npi; i++) pat[i] = '0' + (Sat.val[Cpi[i]] == 1);
+  sat_backtrack(0);
+
+  /* retire the fault's clauses; its variables are then unconstrained and
+     are fixed at level 0 so later searches never decide them */
+  c[0] = a ^ 1;
+  sat_addclause(c, 1);
+  for (q = first + 1; q < Sat.nvars && Sat.ok; q++)
+    if (Sat.val[q] == LX) sat_enqueue(2 * q + 1, -1);
+  if (Sat.ok && sat_propagate() >= 0) Sat.ok = 0;
+  free(u);
+  return (r == 1) ? FS_DET : (r == 0) ? FS_RED : FS_ABORT;
+}
+
+/*========================= End of program ============================*/
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Benchmark ladder: c17 and synthetic circuits of growing size, all
+# engines on the small ones and the bit-parallel ones on the large ones.
+# Every run is appended to the JSON lines file (default bench.json).
+#
+#   FSIM=./fsim NPAT=1024 SMALL="1000 10000" LARGE="100000 1000000" ./bench.sh [out.json]
+
+FSIM=${FSIM:-./fsim}
+NPAT=${NPAT:-1024}
+SMALL=${SMALL:-"1000 10000"}
+LARGE=${LARGE:-"100000 1000000"}
+OUT=${1:-bench.json}
+DIR=${TMPDIR:-/tmp}/fsim-bench.$$
+CKT=$(dirname "$0")/c17.ckt
+
+mkdir -p "$DIR" || exit 1
+cp "$CKT" "$DIR/c17.ckt" || exit 1
+{
+  echo "bench $DIR/c17.ckt $NPAT $OUT"
+  for n in $SMALL; do
+    echo "gen $DIR/syn$n.ckt $n"
+    echo "bench $DIR/syn$n.ckt $NPAT $OUT"
+  done
+  for n in $LARGE; do
+    echo "gen $DIR/syn$n.ckt $n"
+    echo "bench $DIR/syn$n.ckt $NPAT $OUT psim ppsfp mtfs"
+  done
+  echo "quit"
+} | "$FSIM"
+status=$?
+rm -rf "$DIR"
+exit $status
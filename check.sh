@@ -0,0 +1,110 @@
+#!/bin/sh
+# Regression checks. Each case feeds a command script to the simulator
+# and compares what it prints; build with -fsanitize=address to catch
+# memory errors as well.
+#
+#   FSIM=./fsim ./check.sh
+
+FSIM=${FSIM:-./fsim}
+SRC=$(dirname "$0")
+DIR=${TMPDIR:-/tmp}/fsim-check.$$
+fail=0
+
+mkdir -p "$DIR" || exit 1
+echo "gen $DIR/gen.ckt 500 32" | "$FSIM" > /dev/null
+cp "$SRC"/c17.ckt "$SRC"/check/*.ckt "$SRC"/check/*.pat "$DIR" || exit 1
+
+# run name: feed stdin to the simulator, output in $DIR/name.out
+run() {
+  "$FSIM" > "$DIR/$1.out" 2>&1
+  if [ $? -ne 0 ]; then
+    echo "FAIL $1: exit status"
+    fail=1
+    return 1
+  fi
+}
+
+ok() { echo "ok   $1"; }
+bad() { echo "FAIL $1: $2"; fail=1; }
+
+# first pattern that detects each fault of a "pattern N: faults" report
+first() {
+  awk '{ for (i = 3; i <= NF; i++) if (!($i in d)) d[$i] = $2 }
+       END { for (f in d) print f, d[f] }' "$1" | sort
+}
+
+# fault dropping engines must credit each fault to its first detection,
+# the one PFS (no dropping) and CFS report
+detect_case() {
+  name=$1 ckt=$2 pat=$3
+  printf '%s\n' "read $DIR/$ckt" lev gfl "pfs $DIR/$pat $DIR/$name.pfs" \
+    "cfs $DIR/$pat $DIR/$name.cfs" "ppsfp $DIR/$pat $DIR/$name.ppsfp" \
+    "mtfs 3 $DIR/$pat $DIR/$name.mtfs" quit | run "$name" || return
+  first "$DIR/$name.pfs" > "$DIR/$name.ref"
+  for e in cfs ppsfp mtfs; do
+    if ! first "$DIR/$name.$e" | cmp -s - "$DIR/$name.ref"; then
+      bad "$name" "$e first detections differ from PFS"
+      return
+    fi
+  done
+  ok "$name"
+}
+
+detect_case detect_c17 c17.ckt c17.pat
+detect_case detect_gen gen.ckt rand32.pat
+
+# MTSIM streams the same responses as PSIM, text and binary
+printf '%s\n' "read $DIR/gen.ckt" lev "psim $DIR/rand32.pat $DIR/ps.rsp" \
+  "mtsim 3 $DIR/rand32.pat $DIR/mt.rsp" "pack $DIR/rand32.pat $DIR/rand32.bin" \
+  "psim $DIR/rand32.bin $DIR/ps.bin" "mtsim 2 $DIR/rand32.bin $DIR/mt.bin" \
+  quit | run mtsim &&
+{
+  if cmp -s "$DIR/ps.rsp" "$DIR/mt.rsp" && cmp -s "$DIR/ps.bin" "$DIR/mt.bin"; then ok mtsim
+  else bad mtsim "responses differ from PSIM"
+  fi
+}
+
+# a netlist cache with a fanin index out of range is parsed again
+# instead of loaded, and LEV rewrites it
+cp "$DIR/c17.ckt" "$DIR/bad.ckt"
+printf '%s\n' "read $DIR/bad.ckt" lev quit | run cache_write &&
+{
+  n=$(od -An -tu4 -j12 -N4 "$DIR/bad.ckt.fsc")
+  printf '\377\377\377\177' |
+    dd of="$DIR/bad.ckt.fsc" bs=1 seek=$((48 + 4 * (3 * n + 1))) conv=notrunc 2> /dev/null
+  printf '%s\n' "read $DIR/bad.ckt" lev "read $DIR/bad.ckt" quit | run cache_bad &&
+  {
+    if grep -m 1 '==> OK' "$DIR/cache_bad.out" | grep -q compiled; then
+      bad cache_bad "damaged cache loaded"
+    elif [ "$(grep -c 'OK (compiled' "$DIR/cache_bad.out")" -ne 1 ]; then
+      bad cache_bad "cache not rewritten"
+    else ok cache_bad
+    fi
+  }
+}
+
+# ATPG and COMPACT give the same tests whatever ran before them
+printf '%s\n' "read $DIR/gen.ckt" lev gfl "atpg $DIR/r1.t 100 random compact" \
+  "compact $DIR/r1.tc" "atpg $DIR/r2.t 100 random compact" "compact $DIR/r2.tc" \
+  quit | run reseed &&
+{
+  if cmp -s "$DIR/r1.t" "$DIR/r2.t" && cmp -s "$DIR/r1.tc" "$DIR/r2.tc"; then ok reseed
+  else bad reseed "second ATPG/COMPACT run differs"
+  fi
+}
+
+# COMPACT on a test set whose merged cubes lose faults: the original
+# tests added back must fit, and the coverage must not drop.
+printf '%s\n' "read $DIR/compact_loss.ckt" lev gfl "atpg $DIR/cl.t 100 podem" \
+  "compact $DIR/cl.tc" quit | run compact_loss &&
+{
+  cov=$(sed -n 's/.*fault coverage \([0-9.]*\)% before, \([0-9.]*\)% after.*/\1 \2/p' "$DIR/compact_loss.out")
+  set -- $cov
+  if [ -z "$cov" ]; then bad compact_loss "no COMPACT summary"
+  elif [ "$1" != "$2" ]; then bad compact_loss "coverage $1% before, $2% after"
+  else ok compact_loss
+  fi
+}
+
+rm -rf "$DIR"
+exit $fail